@@ -0,0 +1,460 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Measures how far apart two clients playing the same audio are, with the
+ * default audio sink slaving or with the audio servo.
+ *
+ * Both clients play a test signal on the same pipeline clock with the same
+ * base time, the way two clients on a network clock would. Each plays to a
+ * simulated audio device whose clock runs a little fast or slow (by --drift
+ * ppm, in opposite directions), so that without slaving they would drift
+ * apart. Every sample of the test signal carries its own position in the
+ * stream, so the devices know exactly which sample they are playing, and the
+ * phase error is the difference between the two in time.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+#include "sync-audio-servo.h"
+
+#define RATE 48000
+
+/* How often to compare the clients */
+#define SAMPLE_INTERVAL (10 * G_TIME_SPAN_MILLISECOND)
+/* Give both pipelines time to start before we measure */
+#define SETTLE_TIME (2 * G_TIME_SPAN_SECOND)
+
+static gboolean use_servo = FALSE;
+static gdouble drift = 50;
+static gdouble kp = GST_SYNC_AUDIO_SERVO_DEFAULT_PROPORTIONAL_GAIN;
+static gdouble ki = GST_SYNC_AUDIO_SERVO_DEFAULT_INTEGRAL_GAIN;
+static gint duration = 60;
+
+/* A fake audio device that plays at (1 + ppm / 10^6) times the nominal rate,
+ * and remembers which sample it is playing */
+typedef struct {
+  GstAudioSink parent;
+
+  gdouble ppm;
+  gint bpf;
+
+  GMutex lock;
+  gint64 play_end; /* when the device runs out of data */
+  gint64 last_index; /* the first sample in the last write ... */
+  gint64 last_index_time; /* ... and when it started playing */
+} BenchSink;
+
+typedef struct {
+  GstAudioSinkClass parent;
+} BenchSinkClass;
+
+GType bench_sink_get_type (void);
+G_DEFINE_TYPE (BenchSink, bench_sink, GST_TYPE_AUDIO_SINK);
+
+static GstStaticPadTemplate bench_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("audio/x-raw, format = (string) S32LE, "
+      "layout = (string) interleaved, channels = (int) 1, "
+      "rate = (int) [ 1, MAX ]"));
+
+static gdouble
+bench_sink_device_rate (BenchSink * self)
+{
+  return RATE * (1.0 + self->ppm / 1000000.0);
+}
+
+static gboolean
+bench_sink_open (GstAudioSink * sink)
+{
+  return TRUE;
+}
+
+static gboolean
+bench_sink_prepare (GstAudioSink * sink, GstAudioRingBufferSpec * spec)
+{
+  BenchSink *self = (BenchSink *) sink;
+
+  self->bpf = GST_AUDIO_INFO_BPF (&spec->info);
+  self->play_end = 0;
+
+  return TRUE;
+}
+
+static gboolean
+bench_sink_unprepare (GstAudioSink * sink)
+{
+  return TRUE;
+}
+
+static gboolean
+bench_sink_close (GstAudioSink * sink)
+{
+  return TRUE;
+}
+
+static gint
+bench_sink_write (GstAudioSink * sink, gpointer data, guint length)
+{
+  BenchSink *self = (BenchSink *) sink;
+  gint32 first = *(gint32 *) data;
+  gint64 now, start;
+
+  now = g_get_monotonic_time ();
+
+  g_mutex_lock (&self->lock);
+
+  start = MAX (now, self->play_end);
+  self->play_end = start +
+    (length / self->bpf) * G_USEC_PER_SEC / bench_sink_device_rate (self);
+
+  /* Silence inserted by the sink is all zeroes, and tells us nothing */
+  if (first > 0) {
+    self->last_index = first;
+    self->last_index_time = start;
+  }
+
+  g_mutex_unlock (&self->lock);
+
+  /* Like a real device, take the data once there's room for it */
+  if (start > now)
+    g_usleep (start - now);
+
+  return length;
+}
+
+static guint
+bench_sink_delay (GstAudioSink * sink)
+{
+  BenchSink *self = (BenchSink *) sink;
+  gint64 queued;
+
+  g_mutex_lock (&self->lock);
+  queued = self->play_end - g_get_monotonic_time ();
+  g_mutex_unlock (&self->lock);
+
+  if (queued <= 0)
+    return 0;
+
+  return queued * bench_sink_device_rate (self) / G_USEC_PER_SEC;
+}
+
+static void
+bench_sink_reset (GstAudioSink * sink)
+{
+  BenchSink *self = (BenchSink *) sink;
+
+  g_mutex_lock (&self->lock);
+  self->play_end = 0;
+  g_mutex_unlock (&self->lock);
+}
+
+static void
+bench_sink_finalize (GObject * object)
+{
+  BenchSink *self = (BenchSink *) object;
+
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (bench_sink_parent_class)->finalize (object);
+}
+
+static void
+bench_sink_class_init (BenchSinkClass * klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstAudioSinkClass *sink_class = GST_AUDIO_SINK_CLASS (klass);
+
+  object_class->finalize = bench_sink_finalize;
+
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&bench_sink_template));
+  gst_element_class_set_static_metadata (element_class, "Benchmark sink",
+      "Sink/Audio", "Simulated audio device with a drifting clock",
+      "Arun Raghavan <arun@osg.samsung.com>");
+
+  sink_class->open = bench_sink_open;
+  sink_class->prepare = bench_sink_prepare;
+  sink_class->unprepare = bench_sink_unprepare;
+  sink_class->close = bench_sink_close;
+  sink_class->write = bench_sink_write;
+  sink_class->delay = bench_sink_delay;
+  sink_class->reset = bench_sink_reset;
+}
+
+static void
+bench_sink_init (BenchSink * self)
+{
+  g_mutex_init (&self->lock);
+}
+
+/* Which sample the device is playing right now */
+static gdouble
+bench_sink_get_index (BenchSink * self, gint64 now)
+{
+  gdouble index;
+
+  g_mutex_lock (&self->lock);
+  index = self->last_index +
+    (now - self->last_index_time) * bench_sink_device_rate (self) /
+    G_USEC_PER_SEC;
+  g_mutex_unlock (&self->lock);
+
+  return index;
+}
+
+/* Replaces the test signal with each sample's position in the stream */
+static GstPadProbeReturn
+index_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  gint32 *samples;
+  guint64 offset;
+  gsize i;
+
+  buf = gst_buffer_make_writable (GST_PAD_PROBE_INFO_BUFFER (info));
+  GST_PAD_PROBE_INFO_DATA (info) = buf;
+
+  offset = GST_BUFFER_OFFSET (buf);
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  samples = (gint32 *) map.data;
+
+  /* Start at 1, since silence is 0 */
+  for (i = 0; i < map.size / sizeof (gint32); i++)
+    samples[i] = offset + i + 1;
+
+  gst_buffer_unmap (buf, &map);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstElement *
+make_client (GstClock * clock, gdouble ppm, GstSyncAudioServo * servo,
+    BenchSink ** sink)
+{
+  GstElement *pipeline, *src, *filter;
+  GstCaps *caps;
+  GstPad *pad;
+
+  pipeline = gst_pipeline_new (NULL);
+  src = gst_element_factory_make ("audiotestsrc", NULL);
+  filter = gst_element_factory_make ("capsfilter", NULL);
+  *sink = g_object_new (bench_sink_get_type (), NULL);
+
+  if (!src || !filter) {
+    g_print ("Could not create audiotestsrc/capsfilter\n");
+    exit (-1);
+  }
+
+  /* We fill in the samples ourselves */
+  gst_util_set_object_arg (G_OBJECT (src), "wave", "silence");
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, "S32LE",
+      "layout", G_TYPE_STRING, "interleaved",
+      "channels", G_TYPE_INT, 1,
+      "rate", G_TYPE_INT, RATE,
+      NULL);
+  g_object_set (filter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  (*sink)->ppm = ppm;
+
+  /* Same as what GstSyncClient sets */
+  g_object_set (*sink, "drift-tolerance", (gint64) 10000 /* µs */,
+      "alignment-threshold", 10 * GST_MSECOND, NULL);
+
+  if (servo)
+    gst_sync_audio_servo_attach (servo, GST_ELEMENT (*sink));
+
+  gst_bin_add_many (GST_BIN (pipeline), src, filter, GST_ELEMENT (*sink),
+      NULL);
+  gst_element_link_many (src, filter, GST_ELEMENT (*sink), NULL);
+
+  pad = gst_element_get_static_pad (src, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, index_probe, NULL, NULL);
+  gst_object_unref (pad);
+
+  gst_pipeline_use_clock (GST_PIPELINE (pipeline), clock);
+  gst_element_set_start_time (pipeline, GST_CLOCK_TIME_NONE);
+
+  return pipeline;
+}
+
+static gint
+compare_int64 (gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void
+print_percentiles (const gchar * name, GArray * values)
+{
+  gint64 *v;
+  guint n = values->len;
+
+  if (n == 0) {
+    g_print ("%-14s no samples\n", name);
+    return;
+  }
+
+  g_array_sort (values, compare_int64);
+  v = (gint64 *) values->data;
+
+  g_print ("%-14s p50 %8.1f us  p90 %8.1f us  p99 %8.1f us  max %8.1f us\n",
+      name, v[n / 2] / 1000.0, v[n * 90 / 100] / 1000.0,
+      v[n * 99 / 100] / 1000.0, v[n - 1] / 1000.0);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GstClock *clock;
+  GstSyncAudioServo *servos[2] = { NULL, NULL };
+  GstElement *pipelines[2];
+  BenchSink *sinks[2];
+  GArray *errors;
+  GstClockTime base_time;
+  gint64 start, now, next_report, period_max = 0;
+  gint i;
+  static GOptionEntry entries[] =
+  {
+    { "servo", 's', 0, G_OPTION_ARG_NONE, &use_servo,
+      "Use the audio servo instead of the default slaving", NULL },
+    { "drift", 'p', 0, G_OPTION_ARG_DOUBLE, &drift,
+      "How far each device's clock is off (ppm)", "PPM" },
+    { "proportional-gain", 'P', 0, G_OPTION_ARG_DOUBLE, &kp,
+      "Servo proportional gain", "GAIN" },
+    { "integral-gain", 'I', 0, G_OPTION_ARG_DOUBLE, &ki,
+      "Servo integral gain", "GAIN" },
+    { "duration", 'd', 0, G_OPTION_ARG_INT, &duration,
+      "How long to measure for (s)", "S" },
+    { NULL }
+  };
+
+  ctx = g_option_context_new ("audio servo phase error benchmark");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_print ("Failed to parse options: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  g_option_context_free (ctx);
+
+  if (duration < 1) {
+    g_print ("Invalid options\n");
+    return -1;
+  }
+
+  clock = gst_system_clock_obtain ();
+
+  for (i = 0; i < 2; i++) {
+    if (use_servo) {
+      servos[i] = gst_sync_audio_servo_new ();
+      g_object_set (servos[i], "proportional-gain", kp, "integral-gain", ki,
+          NULL);
+    }
+
+    /* One device runs fast, the other slow */
+    pipelines[i] = make_client (clock, i == 0 ? drift : -drift, servos[i],
+        &sinks[i]);
+  }
+
+  if (use_servo)
+    g_print ("audio servo (kp %g, ki %g)", kp, ki);
+  else
+    g_print ("default slaving");
+  g_print (", devices off by +/-%g ppm, %d s\n", drift, duration);
+
+  base_time = gst_clock_get_time (clock) + 100 * GST_MSECOND;
+
+  for (i = 0; i < 2; i++) {
+    gst_element_set_base_time (pipelines[i], base_time);
+
+    if (gst_element_set_state (pipelines[i], GST_STATE_PLAYING) ==
+        GST_STATE_CHANGE_FAILURE) {
+      g_print ("Could not start pipeline\n");
+      return -1;
+    }
+  }
+
+  g_usleep (SETTLE_TIME);
+
+  errors = g_array_new (FALSE, FALSE, sizeof (gint64));
+  start = g_get_monotonic_time ();
+  next_report = start + G_USEC_PER_SEC;
+
+  g_print ("\n  time   max |phase error|\n");
+
+  while ((now = g_get_monotonic_time ()) < start + duration * G_USEC_PER_SEC) {
+    gdouble samples;
+    gint64 error;
+
+    samples = bench_sink_get_index (sinks[0], now) -
+      bench_sink_get_index (sinks[1], now);
+    error = ABS (samples * GST_SECOND / RATE);
+
+    g_array_append_val (errors, error);
+    period_max = MAX (period_max, error);
+
+    if (now >= next_report) {
+      g_print ("%5" G_GINT64_FORMAT " s  %8.1f us\n",
+          (now - start) / G_USEC_PER_SEC, period_max / 1000.0);
+      period_max = 0;
+      next_report += G_USEC_PER_SEC;
+    }
+
+    g_usleep (SAMPLE_INTERVAL);
+  }
+
+  g_print ("\n");
+  print_percentiles ("|phase error|", errors);
+
+  g_array_unref (errors);
+
+  for (i = 0; i < 2; i++) {
+    gst_element_set_state (pipelines[i], GST_STATE_NULL);
+    gst_object_unref (pipelines[i]);
+
+    if (servos[i])
+      g_object_unref (servos[i]);
+  }
+
+  gst_object_unref (clock);
+
+  return 0;
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Measures how far a network client clock is from the clock it is
+ * synchronised to, optionally while the CPU is busy.
+ *
+ * This runs a time server for the system clock and a GstNetClientClock
+ * synchronised to it over loopback. Since both end up reading the same
+ * system clock, the true offset between them is zero, and whatever offset we
+ * observe is error. Busy threads can be added to simulate a client that is
+ * busy decoding (they compete with the server too, as it's in the same
+ * process).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include <gst/gst.h>
+#include <gst/net/gstnet.h>
+
+#include "sync-time-server.h"
+
+/* How often to compare the clocks */
+#define SAMPLE_INTERVAL (10 * G_TIME_SPAN_MILLISECOND)
+
+static gint n_threads = 1;
+static gboolean no_kernel_timestamps = FALSE;
+static gint n_load = 0;
+static gint duration = 30;
+
+static volatile gint running = 1;
+
+static gint
+compare_int64 (gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void
+print_percentiles (const gchar * name, GArray * values)
+{
+  gint64 *v;
+  guint n = values->len;
+
+  if (n == 0) {
+    g_print ("%-14s no samples\n", name);
+    return;
+  }
+
+  g_array_sort (values, compare_int64);
+  v = (gint64 *) values->data;
+
+  g_print ("%-14s p50 %8.1f us  p90 %8.1f us  p99 %8.1f us  max %8.1f us\n",
+      name, v[n / 2] / 1000.0, v[n * 90 / 100] / 1000.0,
+      v[n * 99 / 100] / 1000.0, v[n - 1] / 1000.0);
+}
+
+static gpointer
+load_thread (gpointer user_data)
+{
+  volatile guint64 spins = 0;
+
+  while (g_atomic_int_get (&running))
+    spins++;
+
+  return NULL;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GstClock *clock, *client_clock;
+  GstNetTimeProvider *provider = NULL;
+  GstSyncTimeServer *time_server = NULL;
+  GThread **load;
+  GArray *errors;
+  gint64 end, sum = 0;
+  gint port, i;
+  static GOptionEntry entries[] =
+  {
+    { "threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+      "Built-in time server threads (0 = use GstNetTimeProvider)", "N" },
+    { "no-kernel-timestamps", 'K', 0, G_OPTION_ARG_NONE,
+      &no_kernel_timestamps,
+      "Don't use kernel timestamps in the built-in time server", NULL },
+    { "load", 'l', 0, G_OPTION_ARG_INT, &n_load,
+      "Number of busy threads to run", "N" },
+    { "duration", 'd', 0, G_OPTION_ARG_INT, &duration,
+      "How long to measure for (s)", "S" },
+    { NULL }
+  };
+
+  ctx = g_option_context_new ("network clock offset error benchmark");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_print ("Failed to parse options: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  g_option_context_free (ctx);
+
+  if (n_threads < 0 || n_load < 0 || duration < 1) {
+    g_print ("Invalid options\n");
+    return -1;
+  }
+
+  clock = gst_system_clock_obtain ();
+
+  if (n_threads == 0) {
+    provider = gst_net_time_provider_new (clock, "127.0.0.1", 0);
+    if (!provider) {
+      g_print ("Could not start time provider\n");
+      return -1;
+    }
+
+    g_object_get (provider, "port", &port, NULL);
+    g_print ("GstNetTimeProvider");
+  } else {
+    time_server = gst_sync_time_server_new (clock, "127.0.0.1", 0, n_threads);
+    g_object_set (time_server, "kernel-timestamps", !no_kernel_timestamps,
+        NULL);
+
+    if (!gst_sync_time_server_start (time_server, &err)) {
+      g_print ("Could not start time server: %s\n", err->message);
+      g_error_free (err);
+      return -1;
+    }
+
+    g_object_get (time_server, "port", &port, NULL);
+    g_print ("built-in time server (%s timestamps)",
+        no_kernel_timestamps ? "userspace" : "kernel");
+  }
+
+  g_print (", %d busy threads, %d s\n", n_load, duration);
+
+  client_clock = gst_net_client_clock_new ("bench-clock", "127.0.0.1", port,
+      0);
+
+  if (!gst_clock_wait_for_sync (client_clock, 10 * GST_SECOND)) {
+    g_print ("Client clock did not synchronise\n");
+    return -1;
+  }
+
+  load = g_new0 (GThread *, n_load);
+  for (i = 0; i < n_load; i++)
+    load[i] = g_thread_new ("bench-load", load_thread, NULL);
+
+  errors = g_array_new (FALSE, FALSE, sizeof (gint64));
+  end = g_get_monotonic_time () + duration * G_USEC_PER_SEC;
+
+  while (g_get_monotonic_time () < end) {
+    GstClockTime before, remote, after;
+    gint64 error;
+
+    /* Bracket the client clock reading, since reading a clock takes time */
+    before = gst_clock_get_time (clock);
+    remote = gst_clock_get_time (client_clock);
+    after = gst_clock_get_time (clock);
+
+    error = (gint64) remote - (gint64) (before + (after - before) / 2);
+    sum += error;
+    error = ABS (error);
+    g_array_append_val (errors, error);
+
+    g_usleep (SAMPLE_INTERVAL);
+  }
+
+  g_atomic_int_set (&running, 0);
+  for (i = 0; i < n_load; i++)
+    g_thread_join (load[i]);
+
+  print_percentiles ("|offset error|", errors);
+  g_print ("\n");
+  g_print ("mean error     %.1f us over %u samples\n",
+      sum / 1000.0 / errors->len, errors->len);
+
+  g_array_unref (errors);
+  g_free (load);
+
+  gst_object_unref (client_clock);
+  if (provider)
+    g_object_unref (provider);
+  if (time_server) {
+    gst_sync_time_server_stop (time_server);
+    g_object_unref (time_server);
+  }
+  gst_object_unref (clock);
+
+  return 0;
+}
@@ -0,0 +1,591 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Measures how long it takes for an update to reach every client of the
+ * default (TCP) control server, and what that costs the server.
+ *
+ * This runs a real GstSyncServer, and a load generator thread that opens a
+ * large number of control connections speaking the TCP control protocol
+ * directly, without any media pipelines. Updates are triggered by
+ * alternately pausing/unpausing the server and changing its playlist, and
+ * we record when each client gets the resulting sync info.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include <gst/gst.h>
+#include <gst/sync-server/sync-server.h>
+#include <gst/sync-server/sync-control-server.h>
+#include <gst/sync-server/sync-control-tcp-server.h>
+
+#include "sync-control-tcp-protocol.h"
+
+/* How long to wait for an update to reach every client */
+#define ROUND_TIMEOUT (10 * G_TIME_SPAN_SECOND)
+
+static gint n_clients = 1000;
+static gint n_updates = 50;
+static gint interval = 100;
+static gchar *uri = NULL;
+static guint64 sync_info_version = 0;
+
+typedef struct _Bench Bench;
+
+typedef struct {
+  Bench *bench;
+  GSocket *socket;
+  GSource *source;
+  GByteArray *in;
+  /* Last round we saw an update for */
+  gint round;
+} Client;
+
+struct _Bench {
+  GstSyncServer *server;
+  GMainLoop *loop;
+
+  GMainContext *context;
+  GThread *thread;
+  guint port;
+  Client *clients;
+  guint8 buf[65536];
+
+  GMutex lock;
+  /* Everything below is protected by lock */
+  gint round;
+  gint pending;
+  gint64 trigger_time;
+  gint64 round_start;
+  gint64 first, last;
+  GArray *latencies;
+  GArray *first_latencies;
+  GArray *last_latencies;
+  gint timeouts;
+  gboolean quit;
+
+  /* CPU time used by the load generator, so we can leave it out */
+  struct rusage generator_start, generator_end;
+  struct rusage process_start, process_end;
+};
+
+static gint64
+rusage_cpu_time (const struct rusage * ru)
+{
+  return ru->ru_utime.tv_sec * G_USEC_PER_SEC + ru->ru_utime.tv_usec +
+    ru->ru_stime.tv_sec * G_USEC_PER_SEC + ru->ru_stime.tv_usec;
+}
+
+static void
+get_thread_rusage (struct rusage * ru)
+{
+#ifdef RUSAGE_THREAD
+  getrusage (RUSAGE_THREAD, ru);
+#else
+  memset (ru, 0, sizeof (*ru));
+#endif
+}
+
+/* Reads a "Key: value" line from /proc/self/status, -1 if not available */
+static gint64
+read_proc_status (const gchar * key)
+{
+  gchar *contents, **lines, **line;
+  gint64 ret = -1;
+  gsize key_len = strlen (key);
+
+  if (!g_file_get_contents ("/proc/self/status", &contents, NULL, NULL))
+    return -1;
+
+  lines = g_strsplit (contents, "\n", -1);
+
+  for (line = lines; *line; line++) {
+    if (g_str_has_prefix (*line, key) && (*line)[key_len] == ':') {
+      ret = g_ascii_strtoll (*line + key_len + 1, NULL, 10);
+      break;
+    }
+  }
+
+  g_strfreev (lines);
+  g_free (contents);
+
+  return ret;
+}
+
+static gint
+compare_int64 (gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void
+print_percentiles (const gchar * name, GArray * values)
+{
+  gint64 *v;
+  guint n = values->len;
+
+  if (n == 0) {
+    g_print ("%-14s no samples\n", name);
+    return;
+  }
+
+  g_array_sort (values, compare_int64);
+  v = (gint64 *) values->data;
+
+  g_print ("%-14s p50 %8.2f ms  p90 %8.2f ms  p99 %8.2f ms  max %8.2f ms\n",
+      name, v[n / 2] / 1000.0, v[n * 90 / 100] / 1000.0,
+      v[n * 99 / 100] / 1000.0, v[n - 1] / 1000.0);
+}
+
+static void
+send_message (Client * client, GBytes * msg)
+{
+  gconstpointer data;
+  gsize len;
+
+  data = g_bytes_get_data (msg, &len);
+
+  /* These are tiny, so we don't bother with partial writes */
+  if (g_socket_send_with_blocking (client->socket, data, len, TRUE, NULL,
+        NULL) != (gssize) len)
+    g_printerr ("Could not send message\n");
+
+  g_bytes_unref (msg);
+}
+
+static void
+got_update (Bench * bench, Client * client, gint64 now)
+{
+  gint64 latency;
+
+  g_mutex_lock (&bench->lock);
+
+  if (client->round == bench->round) {
+    g_mutex_unlock (&bench->lock);
+    return;
+  }
+
+  client->round = bench->round;
+
+  if (bench->round > 0) {
+    latency = now - bench->trigger_time;
+    g_array_append_val (bench->latencies, latency);
+
+    if (bench->first < 0 || latency < bench->first)
+      bench->first = latency;
+    if (latency > bench->last)
+      bench->last = latency;
+  }
+
+  bench->pending--;
+
+  /* Everyone has joined, and the measurement starts */
+  if (bench->round == 0 && bench->pending == 0)
+    get_thread_rusage (&bench->generator_start);
+
+  g_mutex_unlock (&bench->lock);
+}
+
+static gboolean
+client_recv_cb (GSocket * socket, GIOCondition cond, gpointer user_data)
+{
+  Client *client = user_data;
+  Bench *bench = client->bench;
+  gssize len;
+  guint8 type;
+  GBytes *payload;
+  gint64 now;
+
+  len = g_socket_receive (socket, (gchar *) bench->buf, sizeof (bench->buf),
+      NULL, NULL);
+  if (len <= 0) {
+    g_printerr ("Lost a control connection\n");
+    client->source = NULL;
+    return G_SOURCE_REMOVE;
+  }
+
+  now = g_get_monotonic_time ();
+
+  g_byte_array_append (client->in, bench->buf, len);
+
+  while (gst_sync_control_tcp_message_pop (client->in, &type, &payload)) {
+    guint64 revisions[2];
+    guint n_revisions;
+
+    if (type == GST_SYNC_CONTROL_TCP_MESSAGE_SYNC_INFO)
+      n_revisions = 1;
+    else if (type == GST_SYNC_CONTROL_TCP_MESSAGE_SYNC_INFO_DELTA)
+      n_revisions = 2;
+    else
+      n_revisions = 0;
+
+    /* We don't decode the sync info itself, but acknowledge it like a real
+     * client would so that the server keeps sending deltas */
+    if (n_revisions && gst_sync_control_tcp_payload_get_revisions (payload,
+          revisions, n_revisions, NULL)) {
+      send_message (client, gst_sync_control_tcp_message_new_with_revisions
+          (GST_SYNC_CONTROL_TCP_MESSAGE_ACK, &revisions[n_revisions - 1], 1,
+           NULL));
+      got_update (bench, client, now);
+    }
+
+    g_bytes_unref (payload);
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean start_round (gpointer user_data);
+
+static gboolean
+end_round (gpointer user_data)
+{
+  Bench *bench = user_data;
+
+  g_mutex_lock (&bench->lock);
+
+  if (bench->round == 0) {
+    g_print ("%d clients joined in %.2f ms\n\n", n_clients,
+        (g_get_monotonic_time () - bench->round_start) / 1000.0);
+    getrusage (RUSAGE_SELF, &bench->process_start);
+  } else {
+    if (bench->pending > 0) {
+      g_printerr ("Update %d reached only %d of %d clients\n", bench->round,
+          n_clients - bench->pending, n_clients);
+      bench->timeouts++;
+    }
+
+    if (bench->first >= 0) {
+      g_array_append_val (bench->first_latencies, bench->first);
+      g_array_append_val (bench->last_latencies, bench->last);
+    }
+  }
+
+  if (bench->round == n_updates) {
+    getrusage (RUSAGE_SELF, &bench->process_end);
+    bench->quit = TRUE;
+    g_mutex_unlock (&bench->lock);
+
+    g_main_loop_quit (bench->loop);
+    return G_SOURCE_REMOVE;
+  }
+
+  g_mutex_unlock (&bench->lock);
+
+  g_timeout_add (interval, start_round, bench);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+check_round (gpointer user_data)
+{
+  Bench *bench = user_data;
+  gboolean done;
+
+  g_mutex_lock (&bench->lock);
+  done = bench->pending == 0 ||
+    g_get_monotonic_time () - bench->round_start > ROUND_TIMEOUT;
+  g_mutex_unlock (&bench->lock);
+
+  if (!done)
+    return G_SOURCE_CONTINUE;
+
+  end_round (bench);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+start_round (gpointer user_data)
+{
+  Bench *bench = user_data;
+  gint round;
+
+  g_mutex_lock (&bench->lock);
+  round = ++bench->round;
+  bench->pending = n_clients;
+  bench->first = -1;
+  bench->last = -1;
+  bench->round_start = bench->trigger_time = g_get_monotonic_time ();
+  g_mutex_unlock (&bench->lock);
+
+  if (round % 2) {
+    /* Odd rounds pause, then unpause */
+    gst_sync_server_set_paused (bench->server, (round / 2) % 2 == 0);
+  } else {
+    gchar *uris[] = { uri, uri };
+    guint64 durations[] = { GST_CLOCK_TIME_NONE, GST_CLOCK_TIME_NONE };
+
+    /* Same current track, so only the sync info changes */
+    g_object_set (bench->server, "playlist",
+        gst_sync_server_playlist_new (uris, durations, (round / 2) % 2 + 1, 0),
+        NULL);
+  }
+
+  g_timeout_add (1, check_round, bench);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer
+generator_thread (gpointer user_data)
+{
+  Bench *bench = user_data;
+  GInetAddress *addr;
+  GSocketAddress *sockaddr;
+  gint i;
+
+  g_main_context_push_thread_default (bench->context);
+
+  addr = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  sockaddr = g_inet_socket_address_new (addr, bench->port);
+
+  for (i = 0; i < n_clients; i++) {
+    Client *client = &bench->clients[i];
+    GError *err = NULL;
+    gchar *id, *info;
+
+    client->socket = g_socket_new (G_SOCKET_FAMILY_IPV4,
+        G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, &err);
+
+    if (!client->socket || !g_socket_connect (client->socket, sockaddr, NULL,
+          &err)) {
+      g_printerr ("Could not connect client %d: %s\n", i, err->message);
+      exit (1);
+    }
+
+    g_socket_set_blocking (client->socket, FALSE);
+    client->bench = bench;
+    client->in = g_byte_array_new ();
+    client->round = -1;
+
+    id = g_strdup_printf ("bench-%05d", i);
+    info = gst_sync_control_tcp_client_info_new (id, NULL);
+    send_message (client, gst_sync_control_tcp_message_new
+        (GST_SYNC_CONTROL_TCP_MESSAGE_CLIENT_INFO, info, strlen (info)));
+    g_free (info);
+    g_free (id);
+
+    client->source = g_socket_create_source (client->socket, G_IO_IN, NULL);
+    g_source_set_callback (client->source, (GSourceFunc) client_recv_cb,
+        client, NULL);
+    g_source_attach (client->source, bench->context);
+  }
+
+  g_object_unref (sockaddr);
+  g_object_unref (addr);
+
+  while (TRUE) {
+    gboolean quit;
+
+    g_main_context_iteration (bench->context, TRUE);
+
+    g_mutex_lock (&bench->lock);
+    quit = bench->quit;
+    g_mutex_unlock (&bench->lock);
+
+    if (quit)
+      break;
+  }
+
+  get_thread_rusage (&bench->generator_end);
+
+  g_main_context_pop_thread_default (bench->context);
+
+  return NULL;
+}
+
+static gboolean
+wake_generator (gpointer user_data)
+{
+  return G_SOURCE_REMOVE;
+}
+
+static void
+raise_fd_limit (void)
+{
+  struct rlimit rl;
+
+  /* Each client needs a descriptor on each end */
+  if (getrlimit (RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit (RLIMIT_NOFILE, &rl);
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GstSyncControlTcpServer *control;
+  Bench bench = { 0, };
+  gchar *uris[1];
+  guint64 durations[1] = { GST_CLOCK_TIME_NONE };
+  gint64 server_cpu, generator_cpu, rss, threads;
+  gint i;
+  static GOptionEntry entries[] =
+  {
+    { "uri", 'u', 0, G_OPTION_ARG_STRING, &uri,
+      "URI for the server to play", "URI" },
+    { "clients", 'c', 0, G_OPTION_ARG_INT, &n_clients,
+      "Number of control connections", "N" },
+    { "updates", 'n', 0, G_OPTION_ARG_INT, &n_updates,
+      "Number of updates to send", "N" },
+    { "interval", 'i', 0, G_OPTION_ARG_INT, &interval,
+      "Time between updates (ms)", "MS" },
+    { "sync-info-version", 'v', 0, G_OPTION_ARG_INT64, &sync_info_version,
+      "Sync info version (1 = JSON, 2 = binary)", "VERSION" },
+    { NULL }
+  };
+
+  ctx = g_option_context_new ("control server fan-out benchmark");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_print ("Failed to parse options: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  g_option_context_free (ctx);
+
+  if (!uri) {
+    g_print ("You must specify a URI for the server to play.\n");
+    return -1;
+  }
+
+  if (n_clients < 1 || n_updates < 1 || interval < 0) {
+    g_print ("Invalid options\n");
+    return -1;
+  }
+
+  raise_fd_limit ();
+
+  bench.server = gst_sync_server_new ("127.0.0.1", 0);
+
+  uris[0] = uri;
+  g_object_set (bench.server, "playlist",
+      gst_sync_server_playlist_new (uris, durations, 1, 0), NULL);
+
+  if (sync_info_version)
+    g_object_set (bench.server, "sync-info-version", sync_info_version, NULL);
+
+  control = g_object_new (GST_TYPE_SYNC_CONTROL_TCP_SERVER, NULL);
+  g_object_set (bench.server, "control-server", control, NULL);
+
+  bench.loop = g_main_loop_new (NULL, FALSE);
+
+  if (!gst_sync_server_start (bench.server, &err)) {
+    g_print ("Could not start server: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  bench.port = gst_sync_control_server_get_port
+    (GST_SYNC_CONTROL_SERVER (control));
+
+  g_mutex_init (&bench.lock);
+  bench.round = 0;
+  bench.pending = n_clients;
+  bench.round_start = g_get_monotonic_time ();
+  bench.latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+  bench.first_latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+  bench.last_latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+  bench.clients = g_new0 (Client, n_clients);
+
+  g_print ("%d clients, %d updates every %d ms\n", n_clients, n_updates,
+      interval);
+
+  bench.context = g_main_context_new ();
+  bench.thread = g_thread_new ("bench-clients", generator_thread, &bench);
+
+  /* Round 0 is everyone joining and getting the initial sync info */
+  g_timeout_add (1, check_round, &bench);
+
+  g_main_loop_run (bench.loop);
+
+  /* Sample these while all the clients are still connected */
+  rss = read_proc_status ("VmRSS");
+  threads = read_proc_status ("Threads");
+
+  g_main_context_invoke (bench.context, wake_generator, NULL);
+  g_thread_join (bench.thread);
+
+  server_cpu = rusage_cpu_time (&bench.process_end) -
+    rusage_cpu_time (&bench.process_start);
+  generator_cpu = rusage_cpu_time (&bench.generator_end) -
+    rusage_cpu_time (&bench.generator_start);
+
+  print_percentiles ("first client", bench.first_latencies);
+  print_percentiles ("last client", bench.last_latencies);
+  print_percentiles ("all clients", bench.latencies);
+
+  g_print ("\n");
+  if (bench.timeouts)
+    g_print ("%d updates did not reach every client\n", bench.timeouts);
+  g_print ("server CPU     %.2f ms per update (%.2f ms load generator)\n",
+      (server_cpu - generator_cpu) / 1000.0 / n_updates,
+      generator_cpu / 1000.0 / n_updates);
+  if (rss >= 0)
+    g_print ("RSS            %" G_GINT64_FORMAT " kB\n", rss);
+  if (threads >= 0) {
+    /* Leave out the load generator thread */
+    g_print ("threads        %" G_GINT64_FORMAT "\n", threads - 1);
+  }
+
+  for (i = 0; i < n_clients; i++) {
+    if (bench.clients[i].source) {
+      g_source_destroy (bench.clients[i].source);
+      g_source_unref (bench.clients[i].source);
+    }
+    if (bench.clients[i].socket)
+      g_object_unref (bench.clients[i].socket);
+    if (bench.clients[i].in)
+      g_byte_array_unref (bench.clients[i].in);
+  }
+
+  gst_sync_server_stop (bench.server);
+  g_object_unref (bench.server);
+  g_object_unref (control);
+  g_main_context_unref (bench.context);
+  g_main_loop_unref (bench.loop);
+
+  g_array_unref (bench.latencies);
+  g_array_unref (bench.first_latencies);
+  g_array_unref (bench.last_latencies);
+  g_free (bench.clients);
+  g_mutex_clear (&bench.lock);
+  g_free (uri);
+
+  return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Compares the cost of encoding and decoding sync information with each of
+ * the supported wire encodings.
+ */
+
+#include <stdlib.h>
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include <gst/sync-server/sync-server.h>
+#include <gst/sync-server/sync-server-info.h>
+
+static gint iterations = 10000;
+static gint n_tracks = 20;
+static gint n_clients = 8;
+
+static GVariant *
+make_transform (void)
+{
+  GVariantBuilder builder;
+  gint i;
+
+  g_variant_builder_init (&builder, GST_TYPE_SYNC_SERVER_TRANSFORM);
+
+  for (i = 0; i < n_clients; i++) {
+    gchar *id = g_strdup_printf ("client-%02d", i);
+
+    g_variant_builder_add_parsed (&builder, "{%s, <{'crop': <{'left': <%i>, "
+        "'right': <%i>}>, 'offset': <{'left': <%i>}>}>}", id,
+        (gint32) (i * 1920), (gint32) ((n_clients - i - 1) * 1920),
+        (gint32) (i * 20));
+
+    g_free (id);
+  }
+
+  return g_variant_builder_end (&builder);
+}
+
+static GstSyncServerInfo *
+make_info (guint64 version)
+{
+  GstSyncServerInfo *info;
+  gchar **uris;
+  guint64 *durations;
+  gint i;
+
+  uris = g_new0 (gchar *, n_tracks + 1);
+  durations = g_new0 (guint64, n_tracks);
+
+  for (i = 0; i < n_tracks; i++) {
+    uris[i] =
+      g_strdup_printf ("http://media.example.com/library/track-%04d.ogg", i);
+    durations[i] = (180 + i) * G_GUINT64_CONSTANT (1000000000);
+  }
+
+  info = gst_sync_server_info_new ();
+
+  g_object_set (info,
+      "version", version,
+      "clock-address", "192.168.1.10",
+      "clock-port", 43211,
+      "playlist", gst_sync_server_playlist_new (uris, durations, n_tracks, 3),
+      "base-time", G_GUINT64_CONSTANT (1234567890123),
+      "base-time-offset", G_GUINT64_CONSTANT (45678901),
+      "latency", G_GUINT64_CONSTANT (300000000),
+      "stream-start-delay", G_GUINT64_CONSTANT (500000000),
+      "stopped", FALSE,
+      "paused", FALSE,
+      "transform", make_transform (),
+      NULL);
+
+  g_strfreev (uris);
+  g_free (durations);
+
+  return info;
+}
+
+static void
+run (const gchar * name, guint64 version)
+{
+  GstSyncServerInfo *info, *decoded;
+  GBytes *bytes = NULL;
+  gint64 start, encode_time, decode_time;
+  gsize len;
+  gint i;
+
+  info = make_info (version);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++) {
+    if (bytes)
+      g_bytes_unref (bytes);
+    bytes = gst_sync_server_info_to_bytes (info);
+  }
+  encode_time = g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++) {
+    decoded = gst_sync_server_info_from_bytes (bytes, NULL);
+    if (!decoded) {
+      g_printerr ("Could not decode %s sync info\n", name);
+      exit (1);
+    }
+    g_object_unref (decoded);
+  }
+  decode_time = g_get_monotonic_time () - start;
+
+  len = g_bytes_get_size (bytes);
+
+  g_print ("%-8s %8" G_GSIZE_FORMAT " bytes %10.2f us/encode "
+      "%10.2f us/decode\n", name, len, (gdouble) encode_time / iterations,
+      (gdouble) decode_time / iterations);
+
+  g_bytes_unref (bytes);
+  g_object_unref (info);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  static GOptionEntry entries[] =
+  {
+    { "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations,
+      "Number of times to encode/decode", "N" },
+    { "tracks", 't', 0, G_OPTION_ARG_INT, &n_tracks,
+      "Number of tracks in the playlist", "N" },
+    { "clients", 'c', 0, G_OPTION_ARG_INT, &n_clients,
+      "Number of clients with a transform", "N" },
+    { NULL }
+  };
+
+  ctx = g_option_context_new ("sync info encoding benchmark");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_print ("Failed to parse options: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  g_option_context_free (ctx);
+
+  if (iterations < 1 || n_tracks < 0 || n_clients < 0) {
+    g_print ("Invalid options\n");
+    return -1;
+  }
+
+  g_print ("%d iterations, %d tracks, %d client transforms\n\n", iterations,
+      n_tracks, n_clients);
+
+  run ("json", GST_SYNC_SERVER_INFO_VERSION_JSON);
+  run ("binary", GST_SYNC_SERVER_INFO_VERSION_BINARY);
+
+  return 0;
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Measures how many clock requests per second the time server can answer, and
+ * how long clients wait for their answers.
+ *
+ * This runs either a GstNetTimeProvider (the default) or the built-in time
+ * server, and a number of load generator threads that each keep a fixed
+ * number of requests in flight on their own socket, the way a large number of
+ * GstNetClientClocks polling at once would.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include <gst/gst.h>
+#include <gst/net/gstnet.h>
+
+#include "sync-time-server.h"
+
+#define PACKET_SIZE 16
+
+/* How long to wait for replies before assuming requests were lost */
+#define LOSS_TIMEOUT (100 * G_TIME_SPAN_MILLISECOND)
+
+static gint n_threads = 0;
+static gint n_clients = 4;
+static gint window = 16;
+static gint duration = 5;
+
+typedef struct {
+  GThread *thread;
+  GSocket *socket;
+
+  GArray *rtts;
+  guint64 sent;
+  guint64 received;
+  guint64 timeouts;
+
+  struct rusage start, end;
+} Client;
+
+static volatile gint running = 1;
+
+static gint64
+rusage_cpu_time (const struct rusage * ru)
+{
+  return ru->ru_utime.tv_sec * G_USEC_PER_SEC + ru->ru_utime.tv_usec +
+    ru->ru_stime.tv_sec * G_USEC_PER_SEC + ru->ru_stime.tv_usec;
+}
+
+static void
+get_thread_rusage (struct rusage * ru)
+{
+#ifdef RUSAGE_THREAD
+  getrusage (RUSAGE_THREAD, ru);
+#else
+  memset (ru, 0, sizeof (*ru));
+#endif
+}
+
+static gint
+compare_int64 (gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void
+print_percentiles (const gchar * name, GArray * values)
+{
+  gint64 *v;
+  guint n = values->len;
+
+  if (n == 0) {
+    g_print ("%-14s no samples\n", name);
+    return;
+  }
+
+  g_array_sort (values, compare_int64);
+  v = (gint64 *) values->data;
+
+  g_print ("%-14s p50 %6" G_GINT64_FORMAT " us  p90 %6" G_GINT64_FORMAT
+      " us  p99 %6" G_GINT64_FORMAT " us  max %6" G_GINT64_FORMAT " us\n",
+      name, v[n / 2], v[n * 90 / 100], v[n * 99 / 100], v[n - 1]);
+}
+
+static void
+send_request (Client * client)
+{
+  guint8 buf[PACKET_SIZE];
+
+  /* The server doesn't look at our local time, so we use it to carry the
+   * send time for measuring the round trip */
+  GST_WRITE_UINT64_BE (buf, g_get_monotonic_time ());
+  GST_WRITE_UINT64_BE (buf + 8, GST_CLOCK_TIME_NONE);
+
+  if (g_socket_send (client->socket, (gchar *) buf, PACKET_SIZE, NULL,
+        NULL) == PACKET_SIZE)
+    client->sent++;
+}
+
+static gpointer
+client_thread (gpointer user_data)
+{
+  Client *client = user_data;
+  guint8 buf[PACKET_SIZE];
+  gint i;
+
+  get_thread_rusage (&client->start);
+
+  for (i = 0; i < window; i++)
+    send_request (client);
+
+  while (g_atomic_int_get (&running)) {
+    gssize len;
+    gint64 rtt;
+
+    if (!g_socket_condition_timed_wait (client->socket, G_IO_IN, LOSS_TIMEOUT,
+          NULL, NULL)) {
+      /* Everything we had in flight was dropped, start over */
+      client->timeouts++;
+      for (i = 0; i < window; i++)
+        send_request (client);
+      continue;
+    }
+
+    len = g_socket_receive (client->socket, (gchar *) buf, PACKET_SIZE, NULL,
+        NULL);
+    if (len != PACKET_SIZE)
+      continue;
+
+    rtt = g_get_monotonic_time () - (gint64) GST_READ_UINT64_BE (buf);
+    g_array_append_val (client->rtts, rtt);
+    client->received++;
+
+    send_request (client);
+  }
+
+  get_thread_rusage (&client->end);
+
+  return NULL;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GstClock *clock;
+  GstNetTimeProvider *provider = NULL;
+  GstSyncTimeServer *time_server = NULL;
+  GSocketAddress *server_addr;
+  Client *clients;
+  GArray *rtts;
+  struct rusage process_start, process_end;
+  gint64 server_cpu, client_cpu = 0, start, elapsed;
+  guint64 sent = 0, received = 0, timeouts = 0;
+  gint port, i;
+  static GOptionEntry entries[] =
+  {
+    { "threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+      "Built-in time server threads (0 = use GstNetTimeProvider)", "N" },
+    { "clients", 'c', 0, G_OPTION_ARG_INT, &n_clients,
+      "Number of load generator threads", "N" },
+    { "window", 'w', 0, G_OPTION_ARG_INT, &window,
+      "Requests in flight per load generator thread", "N" },
+    { "duration", 'd', 0, G_OPTION_ARG_INT, &duration,
+      "How long to run for (s)", "S" },
+    { NULL }
+  };
+
+  ctx = g_option_context_new ("time server packet rate benchmark");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_print ("Failed to parse options: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  g_option_context_free (ctx);
+
+  if (n_threads < 0 || n_clients < 1 || window < 1 || duration < 1) {
+    g_print ("Invalid options\n");
+    return -1;
+  }
+
+  clock = gst_system_clock_obtain ();
+
+  if (n_threads == 0) {
+    provider = gst_net_time_provider_new (clock, "127.0.0.1", 0);
+    if (!provider) {
+      g_print ("Could not start time provider\n");
+      return -1;
+    }
+
+    g_object_get (provider, "port", &port, NULL);
+    g_print ("GstNetTimeProvider, ");
+  } else {
+    time_server = gst_sync_time_server_new (clock, "127.0.0.1", 0, n_threads);
+    if (!gst_sync_time_server_start (time_server, &err)) {
+      g_print ("Could not start time server: %s\n", err->message);
+      g_error_free (err);
+      return -1;
+    }
+
+    g_object_get (time_server, "port", &port, NULL);
+    g_print ("built-in time server with %d thread(s), ", n_threads);
+  }
+
+  g_print ("%d clients with %d requests in flight for %d s\n", n_clients,
+      window, duration);
+
+  server_addr = g_inet_socket_address_new_from_string ("127.0.0.1", port);
+  clients = g_new0 (Client, n_clients);
+
+  for (i = 0; i < n_clients; i++) {
+    clients[i].socket = g_socket_new (G_SOCKET_FAMILY_IPV4,
+        G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, &err);
+    if (!clients[i].socket ||
+        !g_socket_connect (clients[i].socket, server_addr, NULL, &err)) {
+      g_print ("Could not create client socket: %s\n", err->message);
+      g_error_free (err);
+      return -1;
+    }
+
+    clients[i].rtts = g_array_new (FALSE, FALSE, sizeof (gint64));
+  }
+
+  getrusage (RUSAGE_SELF, &process_start);
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < n_clients; i++)
+    clients[i].thread = g_thread_new ("bench-client", client_thread,
+        &clients[i]);
+
+  g_usleep (duration * G_USEC_PER_SEC);
+  g_atomic_int_set (&running, 0);
+
+  rtts = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  for (i = 0; i < n_clients; i++) {
+    g_thread_join (clients[i].thread);
+
+    client_cpu += rusage_cpu_time (&clients[i].end) -
+      rusage_cpu_time (&clients[i].start);
+    sent += clients[i].sent;
+    received += clients[i].received;
+    timeouts += clients[i].timeouts;
+
+    g_array_append_vals (rtts, clients[i].rtts->data, clients[i].rtts->len);
+  }
+
+  elapsed = g_get_monotonic_time () - start;
+  getrusage (RUSAGE_SELF, &process_end);
+
+  server_cpu = rusage_cpu_time (&process_end) -
+    rusage_cpu_time (&process_start) - client_cpu;
+
+  print_percentiles ("round trip", rtts);
+
+  g_print ("\n");
+  g_print ("requests       %.0f per second\n",
+      received * (gdouble) G_USEC_PER_SEC / elapsed);
+  g_print ("lost           %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT
+      " (%" G_GUINT64_FORMAT " timeouts)\n", sent - received, sent, timeouts);
+  if (received) {
+    g_print ("server CPU     %.2f us per request (%.2f us load generator)\n",
+        server_cpu / (gdouble) received, client_cpu / (gdouble) received);
+  }
+
+  for (i = 0; i < n_clients; i++) {
+    g_object_unref (clients[i].socket);
+    g_array_unref (clients[i].rtts);
+  }
+
+  g_free (clients);
+  g_array_unref (rtts);
+  g_object_unref (server_addr);
+
+  if (provider)
+    g_object_unref (provider);
+  if (time_server) {
+    gst_sync_time_server_stop (time_server);
+    g_object_unref (time_server);
+  }
+  gst_object_unref (clock);
+
+  return 0;
+}
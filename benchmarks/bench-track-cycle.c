@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Measures what it costs the server to move from one track to the next.
+ *
+ * This runs a GstSyncServer on a playlist of many short tracks (a generated
+ * WAV file, so nothing beyond wavparse is needed), and records when each
+ * track ends. Ideally, tracks end exactly one track length (plus the stream
+ * start delay) apart, and anything more is time lost switching tracks, which
+ * would accumulate into the server falling behind its own timeline.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <glib-object.h>
+
+#include <gst/gst.h>
+#include <gst/sync-server/sync-server.h>
+
+#define RATE 8000
+
+static gint n_tracks = 1000;
+static gint track_length = 50;
+static gint stream_start_delay = 0;
+static gboolean timeline_only = FALSE;
+
+typedef struct {
+  GMainLoop *loop;
+  GArray *excess;
+  gint64 last_eos;
+  gint n_eos;
+} Bench;
+
+static gint
+compare_int64 (gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void
+print_percentiles (const gchar * name, GArray * values)
+{
+  gint64 *v;
+  guint n = values->len;
+
+  if (n == 0) {
+    g_print ("%-14s no samples\n", name);
+    return;
+  }
+
+  g_array_sort (values, compare_int64);
+  v = (gint64 *) values->data;
+
+  g_print ("%-14s p50 %8.1f us  p90 %8.1f us  p99 %8.1f us  max %8.1f us\n",
+      name, v[n / 2] / 1000.0, v[n * 90 / 100] / 1000.0,
+      v[n * 99 / 100] / 1000.0, v[n - 1] / 1000.0);
+}
+
+static gint64
+rusage_cpu_time (const struct rusage * ru)
+{
+  return ru->ru_utime.tv_sec * G_USEC_PER_SEC + ru->ru_utime.tv_usec +
+    ru->ru_stime.tv_sec * G_USEC_PER_SEC + ru->ru_stime.tv_usec;
+}
+
+static void
+put_le32 (guint8 * p, guint32 v)
+{
+  p[0] = v & 0xff;
+  p[1] = (v >> 8) & 0xff;
+  p[2] = (v >> 16) & 0xff;
+  p[3] = (v >> 24) & 0xff;
+}
+
+/* Writes @ms of 16-bit mono silence as a WAV file */
+static gboolean
+write_wav (const gchar * path, gint ms, GError ** err)
+{
+  guint32 n_samples = (guint64) RATE * ms / 1000;
+  gsize size = 44 + n_samples * 2;
+  guint8 *data;
+  gboolean ret;
+
+  data = g_malloc0 (size);
+
+  memcpy (data, "RIFF", 4);
+  put_le32 (data + 4, size - 8);
+  memcpy (data + 8, "WAVEfmt ", 8);
+  put_le32 (data + 16, 16);
+  data[20] = 1; /* PCM */
+  data[22] = 1; /* channels */
+  put_le32 (data + 24, RATE);
+  put_le32 (data + 28, RATE * 2);
+  data[32] = 2; /* block align */
+  data[34] = 16; /* bits per sample */
+  memcpy (data + 36, "data", 4);
+  put_le32 (data + 40, n_samples * 2);
+
+  ret = g_file_set_contents (path, (const gchar *) data, size, err);
+  g_free (data);
+
+  return ret;
+}
+
+static void
+eos_cb (GstSyncServer * server, gpointer user_data)
+{
+  Bench *bench = user_data;
+  gint64 now = g_get_monotonic_time ();
+
+  if (bench->n_eos > 0) {
+    gint64 excess = (now - bench->last_eos) * 1000 -
+      (gint64) (track_length + stream_start_delay) * GST_MSECOND;
+
+    g_array_append_val (bench->excess, excess);
+  }
+
+  bench->last_eos = now;
+  bench->n_eos++;
+}
+
+static void
+eop_cb (GstSyncServer * server, gpointer user_data)
+{
+  Bench *bench = user_data;
+
+  g_main_loop_quit (bench->loop);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GstSyncServer *server;
+  Bench bench = { 0, };
+  struct rusage start, end;
+  gchar *dir, *path, *uri, **uris;
+  guint64 *durations, duration;
+  gint64 cpu, total = 0, wall;
+  guint i;
+  static GOptionEntry entries[] =
+  {
+    { "tracks", 'n', 0, G_OPTION_ARG_INT, &n_tracks,
+      "Number of tracks to play", "N" },
+    { "length", 'l', 0, G_OPTION_ARG_INT, &track_length,
+      "Length of each track (ms)", "MS" },
+    { "stream-start-delay", 'd', 0, G_OPTION_ARG_INT, &stream_start_delay,
+      "Server stream start delay (ms)", "MS" },
+    { "timeline-only", 't', 0, G_OPTION_ARG_NONE, &timeline_only,
+      "Follow the timeline on the clock without playing tracks", NULL },
+    { NULL }
+  };
+
+  ctx = g_option_context_new ("server track transition benchmark");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_print ("Failed to parse options: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  g_option_context_free (ctx);
+
+  if (n_tracks < 2 || track_length < 1 || stream_start_delay < 0) {
+    g_print ("Invalid options\n");
+    return -1;
+  }
+
+  dir = g_dir_make_tmp ("bench-track-cycle-XXXXXX", &err);
+  if (!dir) {
+    g_print ("Could not create temporary directory: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  path = g_build_filename (dir, "track.wav", NULL);
+  if (!write_wav (path, track_length, &err)) {
+    g_print ("Could not write track: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  uri = gst_filename_to_uri (path, NULL);
+  duration = gst_util_uint64_scale ((guint64) RATE * track_length / 1000,
+      GST_SECOND, RATE);
+
+  uris = g_new0 (gchar *, n_tracks + 1);
+  durations = g_new0 (guint64, n_tracks);
+  for (i = 0; i < n_tracks; i++) {
+    uris[i] = uri;
+    durations[i] = duration;
+  }
+
+  server = gst_sync_server_new ("127.0.0.1", 0);
+  g_object_set (server,
+      "playlist", gst_sync_server_playlist_new (uris, durations, n_tracks, 0),
+      "stream-start-delay", (guint64) stream_start_delay * GST_MSECOND,
+      "timeline-only", timeline_only,
+      NULL);
+
+  bench.loop = g_main_loop_new (NULL, FALSE);
+  bench.excess = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  g_signal_connect (server, "end-of-stream", G_CALLBACK (eos_cb), &bench);
+  g_signal_connect (server, "end-of-playlist", G_CALLBACK (eop_cb), &bench);
+
+  g_print ("%d tracks of %d ms, %d ms stream start delay%s\n", n_tracks,
+      track_length, stream_start_delay,
+      timeline_only ? ", timeline only" : "");
+
+  getrusage (RUSAGE_SELF, &start);
+  wall = g_get_monotonic_time ();
+
+  if (!gst_sync_server_start (server, &err)) {
+    g_print ("Could not start server: %s\n", err->message);
+    g_error_free (err);
+    return -1;
+  }
+
+  g_main_loop_run (bench.loop);
+
+  wall = g_get_monotonic_time () - wall;
+  getrusage (RUSAGE_SELF, &end);
+  cpu = rusage_cpu_time (&end) - rusage_cpu_time (&start);
+
+  for (i = 0; i < bench.excess->len; i++)
+    total += g_array_index (bench.excess, gint64, i);
+
+  print_percentiles ("switch cost", bench.excess);
+  g_print ("\n");
+  g_print ("fell behind    %.1f ms over %d tracks (%.1f s)\n",
+      total / 1000000.0, bench.n_eos, wall / (gdouble) G_USEC_PER_SEC);
+  g_print ("server CPU     %.2f ms per track\n",
+      cpu / 1000.0 / MAX (bench.n_eos, 1));
+
+  gst_sync_server_stop (server);
+  g_object_unref (server);
+  g_main_loop_unref (bench.loop);
+  g_array_unref (bench.excess);
+
+  g_unlink (path);
+  g_rmdir (dir);
+
+  g_free (uris);
+  g_free (durations);
+  g_free (uri);
+  g_free (path);
+  g_free (dir);
+
+  return 0;
+}
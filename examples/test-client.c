@@ -21,6 +21,7 @@
 #include <glib-object.h>
 #include <gst/gst.h>
 #include <gst/sync-server/sync-client.h>
+#include <gst/sync-server/sync-control-udp-client.h>
 
 #define DEFAULT_ADDR "127.0.0.1"
 #define DEFAULT_PORT 3695
@@ -28,6 +29,38 @@
 static gchar *id = NULL;
 static gchar *addr = NULL;
 static gint port = DEFAULT_PORT;
+static gchar *multicast_group = NULL;
+static gboolean fast_start = FALSE;
+static gchar *calibration_file = NULL;
+static gboolean audio_servo = FALSE;
+static gboolean accurate_seek = FALSE;
+
+static void
+startup_time_notify (GObject * object, GParamSpec * pspec,
+    gpointer user_data)
+{
+  guint64 startup_time;
+
+  g_object_get (object, "startup-time", &startup_time, NULL);
+  g_print ("Synchronised playback started after %" GST_TIME_FORMAT "\n",
+      GST_TIME_ARGS (startup_time));
+}
+
+static void
+join_completed (GstSyncClient * client, GVariant * stats, gpointer user_data)
+{
+  gint64 error = 0;
+  guint64 time = 0, seek_time = 0;
+
+  g_variant_lookup (stats, "error", "x", &error);
+  g_variant_lookup (stats, "time", "t", &time);
+  g_variant_lookup (stats, "seek-time", "t", &seek_time);
+
+  g_print ("Joined %" GST_STIME_FORMAT " from the timeline after %"
+      GST_TIME_FORMAT " (seek took %" GST_TIME_FORMAT ")\n",
+      GST_STIME_ARGS (error), GST_TIME_ARGS (time),
+      GST_TIME_ARGS (seek_time));
+}
 
 int main (int argc, char **argv)
 {
@@ -43,6 +76,17 @@ int main (int argc, char **argv)
       "ADDR" },
     { "port", 'p', 0, G_OPTION_ARG_INT, &port, "Port to connect to",
       "PORT" },
+    { "multicast", 'm', 0, G_OPTION_ARG_STRING, &multicast_group,
+      "Receive sync info on this multicast group instead of using TCP",
+      "GROUP" },
+    { "fast-start", 'f', 0, G_OPTION_ARG_NONE, &fast_start,
+      "Preroll while the clock synchronises", NULL },
+    { "calibration-file", 'c', 0, G_OPTION_ARG_FILENAME, &calibration_file,
+      "Save clock calibration to, and start from, this file", "FILE" },
+    { "audio-servo", 's', 0, G_OPTION_ARG_NONE, &audio_servo,
+      "Continuously adjust audio to track the network clock", NULL },
+    { "accurate-seek", 'A', 0, G_OPTION_ARG_NONE, &accurate_seek,
+      "Seek to the exact join position rather than the next keyframe", NULL },
     { NULL }
   };
 
@@ -64,6 +108,32 @@ int main (int argc, char **argv)
 
   client = gst_sync_client_new (addr, port);
 
+  if (fast_start)
+    g_object_set (client, "fast-start", TRUE, NULL);
+
+  if (calibration_file)
+    g_object_set (client, "calibration-file", calibration_file, NULL);
+
+  if (audio_servo)
+    g_object_set (client, "audio-servo", TRUE, NULL);
+
+  if (accurate_seek)
+    g_object_set (client, "seek-flags", GST_SEEK_FLAG_ACCURATE, NULL);
+
+  g_signal_connect (client, "notify::startup-time",
+      G_CALLBACK (startup_time_notify), NULL);
+  g_signal_connect (client, "join-completed", G_CALLBACK (join_completed),
+      NULL);
+
+  if (multicast_group) {
+    GstSyncControlUdpClient *udp_client;
+
+    udp_client = g_object_new (GST_TYPE_SYNC_CONTROL_UDP_CLIENT,
+        "multicast-group", multicast_group, NULL);
+    g_object_set (client, "control-client", udp_client, NULL);
+    g_object_unref (udp_client);
+  }
+
   if (id)
     g_object_set (G_OBJECT (client), "id", id, NULL);
 
@@ -84,4 +154,6 @@ done:
 
   g_free (id);
   g_free (addr);
+  g_free (multicast_group);
+  g_free (calibration_file);
 }
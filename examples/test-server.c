@@ -26,6 +26,7 @@
 #include <gst/gst.h>
 
 #include <gst/sync-server/sync-server.h>
+#include <gst/sync-server/sync-control-udp-server.h>
 
 #define DEFAULT_ADDR "0.0.0.0"
 #define DEFAULT_PORT 3695
@@ -40,6 +41,9 @@ static guint64 n_tracks;
 static gchar *addr = NULL;
 static gint port = DEFAULT_PORT;
 static guint64 latency = 0;
+static guint64 sync_info_version = 0;
+static gchar *multicast_group = NULL;
+static gboolean timeline_only = FALSE;
 static GMainLoop *loop;
 
 static gboolean
@@ -231,6 +235,14 @@ int main (int argc, char **argv)
       "PORT" },
     { "latency", 'l', 0, G_OPTION_ARG_INT64, &latency, "Pipeline latency",
       "LATENCY" },
+    { "sync-info-version", 'v', 0, G_OPTION_ARG_INT64, &sync_info_version,
+      "Sync info version (1 = JSON, 2 = binary)", "VERSION" },
+    { "multicast", 'm', 0, G_OPTION_ARG_STRING, &multicast_group,
+      "Send sync info to this multicast group instead of using TCP",
+      "GROUP" },
+    { "timeline-only", 't', 0, G_OPTION_ARG_NONE, &timeline_only,
+      "Don't play tracks whose duration is known, just follow the clock",
+      NULL },
     { NULL }
   };
 
@@ -259,6 +271,15 @@ int main (int argc, char **argv)
 
   server = gst_sync_server_new (addr, port);
 
+  if (multicast_group) {
+    GstSyncControlUdpServer *udp_server;
+
+    udp_server = g_object_new (GST_TYPE_SYNC_CONTROL_UDP_SERVER,
+        "multicast-group", multicast_group, NULL);
+    g_object_set (server, "control-server", udp_server, NULL);
+    g_object_unref (udp_server);
+  }
+
   if (!read_playlist_file (playlist_path))
     return -1;
 
@@ -271,6 +292,12 @@ int main (int argc, char **argv)
   if (latency)
     g_object_set (server, "latency", latency, NULL);
 
+  if (sync_info_version)
+    g_object_set (server, "sync-info-version", sync_info_version, NULL);
+
+  if (timeline_only)
+    g_object_set (server, "timeline-only", TRUE, NULL);
+
   loop = g_main_loop_new (NULL, FALSE);
 
   gst_sync_server_start (server, NULL);
@@ -297,4 +324,5 @@ int main (int argc, char **argv)
   g_free (playlist_path);
   g_free (config_path);
   g_free (addr);
+  g_free (multicast_group);
 }
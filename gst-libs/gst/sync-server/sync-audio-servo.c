@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Keeps an audio sink's device clock locked to the pipeline clock.
+ *
+ * By default, GstAudioBaseSink lets the device clock drift from the pipeline
+ * clock until they are drift-tolerance apart, and then jumps by the whole
+ * difference, which is audible. Instead, we use the sink's custom slaving
+ * hook, which asks us how much to skew playback by every time the sink
+ * renders. A PI controller turns the phase error between the two clocks into
+ * a skew: the proportional term pulls the phase back in, and the integral
+ * term learns the rate difference between the clocks, so that in steady state
+ * we apply a small, steady correction instead of waiting for the error to
+ * build up. Each step is limited to max-step (a couple of samples by
+ * default), which the sink applies by dropping or repeating that much audio.
+ */
+
+#include <gst/audio/audio.h>
+
+#include "sync-audio-servo.h"
+
+#define DEFAULT_PROPORTIONAL_GAIN GST_SYNC_AUDIO_SERVO_DEFAULT_PROPORTIONAL_GAIN
+#define DEFAULT_INTEGRAL_GAIN GST_SYNC_AUDIO_SERVO_DEFAULT_INTEGRAL_GAIN
+#define DEFAULT_MAX_STEP GST_SYNC_AUDIO_SERVO_DEFAULT_MAX_STEP
+/* Beyond this, we don't try to be smooth (same as the default we used to set
+ * for drift-tolerance) */
+#define DEFAULT_RESYNC_THRESHOLD (10 * GST_MSECOND)
+
+struct _GstSyncAudioServo {
+  GObject parent;
+
+  GMutex lock;
+
+  gdouble kp;
+  gdouble ki;
+  guint64 max_step;
+  guint64 resync_threshold;
+
+  /* Sum of the errors seen so far, for the integral term */
+  gdouble integral;
+  gint64 error;
+};
+
+struct _GstSyncAudioServoClass {
+  GObjectClass parent;
+};
+
+#define gst_sync_audio_servo_parent_class parent_class
+G_DEFINE_TYPE (GstSyncAudioServo, gst_sync_audio_servo, G_TYPE_OBJECT);
+
+GST_DEBUG_CATEGORY_STATIC (sync_audio_servo_debug);
+#define GST_CAT_DEFAULT sync_audio_servo_debug
+
+enum {
+  PROP_0,
+  PROP_PROPORTIONAL_GAIN,
+  PROP_INTEGRAL_GAIN,
+  PROP_MAX_STEP,
+  PROP_RESYNC_THRESHOLD,
+  PROP_ERROR,
+};
+
+static void
+gst_sync_audio_servo_finalize (GObject * object)
+{
+  GstSyncAudioServo *self = GST_SYNC_AUDIO_SERVO (object);
+
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_sync_audio_servo_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstSyncAudioServo *self = GST_SYNC_AUDIO_SERVO (object);
+
+  g_mutex_lock (&self->lock);
+
+  switch (property_id) {
+    case PROP_PROPORTIONAL_GAIN:
+      self->kp = g_value_get_double (value);
+      break;
+
+    case PROP_INTEGRAL_GAIN:
+      self->ki = g_value_get_double (value);
+      self->integral = 0;
+      break;
+
+    case PROP_MAX_STEP:
+      self->max_step = g_value_get_uint64 (value);
+      break;
+
+    case PROP_RESYNC_THRESHOLD:
+      self->resync_threshold = g_value_get_uint64 (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+
+  g_mutex_unlock (&self->lock);
+}
+
+static void
+gst_sync_audio_servo_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstSyncAudioServo *self = GST_SYNC_AUDIO_SERVO (object);
+
+  g_mutex_lock (&self->lock);
+
+  switch (property_id) {
+    case PROP_PROPORTIONAL_GAIN:
+      g_value_set_double (value, self->kp);
+      break;
+
+    case PROP_INTEGRAL_GAIN:
+      g_value_set_double (value, self->ki);
+      break;
+
+    case PROP_MAX_STEP:
+      g_value_set_uint64 (value, self->max_step);
+      break;
+
+    case PROP_RESYNC_THRESHOLD:
+      g_value_set_uint64 (value, self->resync_threshold);
+      break;
+
+    case PROP_ERROR:
+      g_value_set_int64 (value, self->error);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+
+  g_mutex_unlock (&self->lock);
+}
+
+static void
+gst_sync_audio_servo_class_init (GstSyncAudioServoClass * klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = gst_sync_audio_servo_finalize;
+  object_class->set_property = gst_sync_audio_servo_set_property;
+  object_class->get_property = gst_sync_audio_servo_get_property;
+
+  g_object_class_install_property (object_class, PROP_PROPORTIONAL_GAIN,
+      g_param_spec_double ("proportional-gain", "Proportional gain",
+        "Fraction of the phase error to correct on each update", 0.0, 1.0,
+        DEFAULT_PROPORTIONAL_GAIN,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_INTEGRAL_GAIN,
+      g_param_spec_double ("integral-gain", "Integral gain",
+        "Fraction of the accumulated phase error to correct on each update",
+        0.0, 1.0, DEFAULT_INTEGRAL_GAIN,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_MAX_STEP,
+      g_param_spec_uint64 ("max-step", "Maximum step",
+        "Largest correction to make in one update (ns)", 0, G_MAXUINT64,
+        DEFAULT_MAX_STEP, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_RESYNC_THRESHOLD,
+      g_param_spec_uint64 ("resync-threshold", "Resync threshold",
+        "Errors larger than this are corrected in one go (ns)", 0,
+        G_MAXUINT64, DEFAULT_RESYNC_THRESHOLD,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_ERROR,
+      g_param_spec_int64 ("error", "Error",
+        "Last measured phase error of the device clock (ns)", G_MININT64,
+        G_MAXINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  GST_DEBUG_CATEGORY_INIT (sync_audio_servo_debug, "syncaudioservo", 0,
+      "GstSyncAudioServo");
+}
+
+static void
+gst_sync_audio_servo_init (GstSyncAudioServo * self)
+{
+  g_mutex_init (&self->lock);
+
+  self->kp = DEFAULT_PROPORTIONAL_GAIN;
+  self->ki = DEFAULT_INTEGRAL_GAIN;
+  self->max_step = DEFAULT_MAX_STEP;
+  self->resync_threshold = DEFAULT_RESYNC_THRESHOLD;
+
+  self->integral = 0;
+  self->error = 0;
+}
+
+/*
+ * gst_sync_audio_servo_new:
+ *
+ * Returns: (transfer full): A new #GstSyncAudioServo, which needs to be
+ *          attached to a sink with gst_sync_audio_servo_attach().
+ */
+GstSyncAudioServo *
+gst_sync_audio_servo_new (void)
+{
+  return g_object_new (GST_TYPE_SYNC_AUDIO_SERVO, NULL);
+}
+
+/* Called from the sink's streaming thread every time it renders */
+static void
+slaving_cb (GstAudioBaseSink * sink, GstClockTime etime, GstClockTime itime,
+    GstClockTimeDiff * requested_skew,
+    GstAudioBaseSinkDiscontReason discont_reason, gpointer user_data)
+{
+  GstSyncAudioServo *self = GST_SYNC_AUDIO_SERVO (user_data);
+  GstClockTimeDiff error, skew, max_step;
+  gdouble max_integral;
+
+  g_mutex_lock (&self->lock);
+
+  if (discont_reason != GST_AUDIO_BASE_SINK_DISCONT_REASON_NO_DISCONT) {
+    /* The sink is starting over, and so do we. There is nothing to skew in
+     * this case, and @requested_skew is NULL. */
+    self->integral = 0;
+    self->error = 0;
+    goto done;
+  }
+
+  /* Positive if the device is ahead of the pipeline clock */
+  error = GST_CLOCK_DIFF (etime, itime);
+  self->error = error;
+  max_step = self->max_step;
+
+  if ((guint64) ABS (error) > self->resync_threshold) {
+    GST_DEBUG_OBJECT (sink, "Resyncing, error %" GST_STIME_FORMAT,
+        GST_STIME_ARGS (error));
+    self->integral = 0;
+    if (requested_skew)
+      *requested_skew = error;
+    goto done;
+  }
+
+  /* Don't let the integral term alone ask for more than we can apply, or it
+   * will take forever to unwind */
+  self->integral += error;
+  if (self->ki > 0) {
+    max_integral = max_step / self->ki;
+    self->integral = CLAMP (self->integral, -max_integral, max_integral);
+  }
+
+  skew = self->kp * error + self->ki * self->integral;
+  skew = CLAMP (skew, -max_step, max_step);
+  if (requested_skew)
+    *requested_skew = skew;
+
+  GST_LOG_OBJECT (sink, "Error %" GST_STIME_FORMAT ", skewing by %"
+      GST_STIME_FORMAT, GST_STIME_ARGS (error), GST_STIME_ARGS (skew));
+
+done:
+  g_mutex_unlock (&self->lock);
+}
+
+static GstElement *
+find_audio_base_sink (GstElement * element)
+{
+  GstIterator *it;
+  GValue item = G_VALUE_INIT;
+  GstElement *found = NULL;
+
+  if (GST_IS_AUDIO_BASE_SINK (element))
+    return gst_object_ref (element);
+
+  if (!GST_IS_BIN (element))
+    return NULL;
+
+  /* e.g. autoaudiosink, or a bin of filters and a sink */
+  it = gst_bin_iterate_recurse (GST_BIN (element));
+
+  while (!found && gst_iterator_next (it, &item) == GST_ITERATOR_OK) {
+    GstElement *child = g_value_get_object (&item);
+
+    if (GST_IS_AUDIO_BASE_SINK (child))
+      found = gst_object_ref (child);
+
+    g_value_reset (&item);
+  }
+
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+  return found;
+}
+
+/*
+ * gst_sync_audio_servo_attach:
+ * @servo: The #GstSyncAudioServo
+ * @sink: An audio sink, or a bin containing one
+ *
+ * Makes @servo responsible for keeping @sink's device clock in sync with the
+ * pipeline clock. For a bin, the sink must already have been created, so this
+ * should be done once the pipeline is in the READY state.
+ *
+ * Returns: #TRUE if an audio sink to control was found
+ */
+gboolean
+gst_sync_audio_servo_attach (GstSyncAudioServo * servo, GstElement * sink)
+{
+  GstElement *audio_sink;
+
+  audio_sink = find_audio_base_sink (sink);
+  if (!audio_sink) {
+    GST_WARNING_OBJECT (servo, "No audio sink to control in %"
+        GST_PTR_FORMAT, sink);
+    return FALSE;
+  }
+
+  g_mutex_lock (&servo->lock);
+  servo->integral = 0;
+  servo->error = 0;
+  g_mutex_unlock (&servo->lock);
+
+  gst_audio_base_sink_set_custom_slaving_callback (
+      GST_AUDIO_BASE_SINK (audio_sink), slaving_cb, g_object_ref (servo),
+      g_object_unref);
+  g_object_set (audio_sink, "slave-method",
+      GST_AUDIO_BASE_SINK_SLAVE_CUSTOM, NULL);
+
+  gst_object_unref (audio_sink);
+
+  return TRUE;
+}
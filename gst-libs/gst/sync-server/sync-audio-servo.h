@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SYNC_AUDIO_SERVO_H
+#define __GST_SYNC_AUDIO_SERVO_H
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_SYNC_AUDIO_SERVO (gst_sync_audio_servo_get_type ())
+G_DECLARE_FINAL_TYPE (GstSyncAudioServo, gst_sync_audio_servo, GST,
+    SYNC_AUDIO_SERVO, GObject);
+
+#define GST_SYNC_AUDIO_SERVO_DEFAULT_PROPORTIONAL_GAIN 0.1
+#define GST_SYNC_AUDIO_SERVO_DEFAULT_INTEGRAL_GAIN 0.005
+#define GST_SYNC_AUDIO_SERVO_DEFAULT_MAX_STEP (50 * GST_USECOND)
+
+GstSyncAudioServo * gst_sync_audio_servo_new (void);
+
+gboolean gst_sync_audio_servo_attach (GstSyncAudioServo * servo,
+    GstElement * sink);
+
+G_END_DECLS
+
+#endif /* __GST_SYNC_AUDIO_SERVO_H */
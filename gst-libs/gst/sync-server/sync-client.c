@@ -37,6 +37,7 @@
 #include <gst/net/gstnet.h>
 
 #include "sync-server-info.h"
+#include "sync-audio-servo.h"
 #include "sync-client.h"
 #include "sync-control-client.h"
 #include "sync-control-tcp-client.h"
@@ -47,6 +48,11 @@ enum {
   DONE_SEEK,
 };
 
+typedef struct {
+  GstPad *pad;
+  gulong id;
+} JoinProbe;
+
 struct _GstSyncClient {
   GObject parent;
 
@@ -65,9 +71,93 @@ struct _GstSyncClient {
   GstSyncControlClient *client;
   gboolean synchronised;
 
+  gboolean fast_start;
+  guint64 sync_error_bound;
+  /* Whether the clock is good enough to start playback */
+  gboolean clock_ready;
+  gint64 sync_start;
+  gboolean fast_polling;
+  guint64 saved_timeout;
+  guint64 saved_min_update_interval;
+
+  gboolean adaptive_poll;
+  GstClockTime poll_interval;
+  gint64 rtt_avg; /* smoothed round trip time */
+  gint64 rtt_dev; /* smoothed mean deviation of the round trip time */
+  guint stable_polls;
+
+  gchar *calibration_file;
+  gchar *calibration_key;
+  /* Our own system clock, which is what calibration maps from, and which we
+   * play with (slaved to the network clock) if we seeded it */
+  GstClock *local_clock;
+  gboolean seeded;
+  gint64 last_calibration_save;
+
+  gint64 start_time;
+  GstClockTime startup_time;
+
+  GVariant *clock_stats;
+  GMutex stats_lock;
+  guint stats_interval;
+  gint64 last_stats_report;
+  gboolean last_stats_synchronised;
+
+  /* How long we took to preroll plus what the pipeline reports, as a hint for
+   * the server's automatic latency (under stats_lock) */
+  gint64 preroll_start;
+  GstClockTime measured_latency;
+
+  gboolean use_audio_servo;
+  GstSyncAudioServo *audio_servo;
+
   /* See bus_cb() for why this needs to be atomic */
   volatile int seek_state;
   gint64 seek_offset;
+  gboolean is_live;
+
+  /* We hold the first buffers back at playsink's inputs until we've seeked to
+   * where we should join, so we only decode and preroll once (see
+   * start_join()). These are touched from streaming threads, so they are
+   * under join_lock. */
+  GMutex join_lock;
+  gboolean can_join_seek;
+  gboolean join_pending;
+  gboolean join_blocked;
+  gint64 join_block_time;
+  GSList *join_probes;
+
+  /* How to seek to the timeline, and how far off it we need to be first */
+  GstSeekFlags seek_flags;
+  GstClockTime seek_tolerance;
+  gchar *current_uri;
+  /* How long seeks take to complete, per URI, so we can seek to where the
+   * timeline will be rather than where it is (under join_lock, as is the
+   * rest of this) */
+  GHashTable *seek_times;
+  GstClockTime last_seek_time;
+  gchar *seek_uri;
+  gint64 seek_start;
+  /* The join we're reporting on with join-completed */
+  gboolean joining;
+  gint64 join_start;
+  GVariant *join_result;
+
+  /* When tracks follow each other with no delay, we hand playbin the next
+   * one from about-to-finish, and catch up with the timeline when it starts
+   * (under join_lock, as about-to-finish is emitted on a streaming thread) */
+  gchar *next_uri;
+  gboolean gapless_pending;
+
+  guint position_check_interval;
+  guint position_check_id;
+  /* Base time adjustment for small position errors */
+  gint64 position_correction;
+  /* Smoothed position error, and corrections made so far (under stats_lock) */
+  gint64 position_error;
+  gboolean have_position_error;
+  guint64 position_nudges;
+  guint64 position_seeks;
 
   gint64 last_duration;
 };
@@ -90,16 +180,90 @@ enum {
   PROP_CONTROL_ADDRESS,
   PROP_CONTROL_PORT,
   PROP_PIPELINE,
+  PROP_CLOCK_STATS,
+  PROP_STATS_INTERVAL,
+  PROP_FAST_START,
+  PROP_SYNC_ERROR_BOUND,
+  PROP_CALIBRATION_FILE,
+  PROP_STARTUP_TIME,
+  PROP_ADAPTIVE_POLL,
+  PROP_POSITION_CHECK_INTERVAL,
+  PROP_POSITION_STATS,
+  PROP_AUDIO_SERVO,
+  PROP_AUDIO_SERVO_PROPORTIONAL_GAIN,
+  PROP_AUDIO_SERVO_INTEGRAL_GAIN,
+  PROP_AUDIO_SERVO_MAX_STEP,
+  PROP_SEEK_FLAGS,
+  PROP_SEEK_TOLERANCE,
 };
 
 #define DEFAULT_PORT 0
+#define DEFAULT_STATS_INTERVAL 5000 /* ms */
+#define DEFAULT_FAST_START FALSE
+#define DEFAULT_SYNC_ERROR_BOUND (5 * GST_MSECOND)
+#define DEFAULT_ADAPTIVE_POLL TRUE
+#define DEFAULT_POSITION_CHECK_INTERVAL 1000 /* ms */
+#define DEFAULT_AUDIO_SERVO FALSE
+#define DEFAULT_SEEK_FLAGS (GST_SEEK_FLAG_KEY_UNIT | GST_SEEK_FLAG_SNAP_AFTER)
 #define DEFAULT_SEEK_TOLERANCE (200 * GST_MSECOND)
 
+/* How often to poll the clock while it converges in fast start mode */
+#define FAST_POLL_INTERVAL (10 * GST_MSECOND)
+/* If the clock doesn't get within the error bound in this much time, we start
+ * playback anyway rather than never playing */
+#define CONVERGENCE_TIMEOUT (10 * G_TIME_SPAN_SECOND)
+
+/* Bounds for the adaptive clock poll interval. We start at the bottom (which
+ * is higher unless the server gives us a budget, see get_poll_floor()), and
+ * double the interval every STABLE_POLLS polls that look stable. */
+#define MIN_POLL_INTERVAL (50 * GST_MSECOND)
+#define MAX_POLL_INTERVAL (8 * GST_SECOND)
+#define STABLE_POLLS 4
+/* Round trip time jitter and clock corrections below this are considered
+ * noise, regardless of the measured deviation */
+#define NOISE_FLOOR (500 * GST_USECOND)
+
+/* How often to save our clock calibration, and how old a saved calibration
+ * can be before drift makes it useless */
+#define CALIBRATION_SAVE_INTERVAL (30 * G_TIME_SPAN_SECOND)
+#define CALIBRATION_MAX_AGE (G_TIME_SPAN_HOUR)
+
+/* Position errors smaller than this are left alone, larger ones are corrected
+ * by moving the base time up to the seek tolerance, and past that, by
+ * seeking */
+#define POSITION_ERROR_THRESHOLD (5 * GST_MSECOND)
+
+/* Posted on the pipeline bus when a clock that does not report its own
+ * statistics on the bus (i.e. PTP) synchronises */
+#define CLOCK_SYNCED_MESSAGE "gst-sync-client-clock-synced"
+
+static void stop_join (GstSyncClient * self);
+
 static void
 gst_sync_client_dispose (GObject * object)
 {
   GstSyncClient *self = GST_SYNC_CLIENT (object);
 
+  stop_join (self);
+  g_mutex_clear (&self->join_lock);
+
+  g_free (self->current_uri);
+  self->current_uri = NULL;
+  g_free (self->seek_uri);
+  self->seek_uri = NULL;
+  g_free (self->next_uri);
+  self->next_uri = NULL;
+
+  if (self->seek_times) {
+    g_hash_table_unref (self->seek_times);
+    self->seek_times = NULL;
+  }
+
+  if (self->join_result) {
+    g_variant_unref (self->join_result);
+    self->join_result = NULL;
+  }
+
   if (self->pipeline) {
     gst_object_unref (self->pipeline);
     self->pipeline = NULL;
@@ -110,6 +274,11 @@ gst_sync_client_dispose (GObject * object)
     self->clock = NULL;
   }
 
+  if (self->position_check_id) {
+    g_source_remove (self->position_check_id);
+    self->position_check_id = 0;
+  }
+
   g_free (self->id);
   self->id = NULL;
 
@@ -128,6 +297,28 @@ gst_sync_client_dispose (GObject * object)
 
   g_mutex_clear (&self->info_lock);
 
+  if (self->clock_stats) {
+    g_variant_unref (self->clock_stats);
+    self->clock_stats = NULL;
+  }
+
+  g_mutex_clear (&self->stats_lock);
+
+  if (self->local_clock) {
+    gst_object_unref (self->local_clock);
+    self->local_clock = NULL;
+  }
+
+  if (self->audio_servo) {
+    g_object_unref (self->audio_servo);
+    self->audio_servo = NULL;
+  }
+
+  g_free (self->calibration_file);
+  self->calibration_file = NULL;
+  g_free (self->calibration_key);
+  self->calibration_key = NULL;
+
   if (self->client) {
     gst_sync_control_client_stop (self->client);
     g_object_unref (self->client);
@@ -143,14 +334,14 @@ set_base_time (GstSyncClient * self)
   gst_element_set_start_time (GST_ELEMENT (self->pipeline),
       GST_CLOCK_TIME_NONE);
 
-  GST_DEBUG_OBJECT (self, "Updating base time to: %lu + %lu + %lu",
+  GST_DEBUG_OBJECT (self, "Updating base time to: %lu + %lu + %lu + %ld",
       gst_sync_server_info_get_base_time (self->info),
       gst_sync_server_info_get_base_time_offset (self->info),
-      self->seek_offset);
+      self->seek_offset, self->position_correction);
   gst_element_set_base_time (GST_ELEMENT (self->pipeline),
       gst_sync_server_info_get_base_time (self->info) +
       gst_sync_server_info_get_base_time_offset (self->info) +
-      self->seek_offset);
+      self->seek_offset + self->position_correction);
 }
 
 #define LOOKUP_AND_SET(v, e, prop, typ, val)            \
@@ -293,6 +484,371 @@ done:
     g_variant_unref (all);
 }
 
+/* The clock we play back with */
+static GstClock *
+get_playback_clock (GstSyncClient * self)
+{
+  return self->seeded ? self->local_clock : self->clock;
+}
+
+/* Mark when we first start playing in sync */
+static void
+update_startup_time (GstSyncClient * self)
+{
+  if (GST_CLOCK_TIME_IS_VALID (self->startup_time))
+    return;
+
+  self->startup_time =
+    (g_get_monotonic_time () - self->start_time) * GST_USECOND;
+
+  GST_INFO_OBJECT (self, "Started synchronised playback after %"
+      GST_TIME_FORMAT, GST_TIME_ARGS (self->startup_time));
+
+  g_object_notify (G_OBJECT (self), "startup-time");
+}
+
+static gboolean
+join_completed_idle (gpointer user_data)
+{
+  GstSyncClient *self = GST_SYNC_CLIENT (user_data);
+  GVariant *result;
+
+  g_mutex_lock (&self->join_lock);
+  result = self->join_result;
+  self->join_result = NULL;
+  g_mutex_unlock (&self->join_lock);
+
+  if (result) {
+    g_signal_emit_by_name (self, "join-completed", result);
+    g_variant_unref (result);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Call with join_lock held. @error is how far ahead of the timeline we ended
+ * up, and @seek_time is how long the seek took, if we seeked. */
+static void
+finish_join (GstSyncClient * self, gint64 error, GstClockTime seek_time)
+{
+  GVariantBuilder builder;
+  GstClockTime time;
+
+  if (!self->joining)
+    return;
+
+  self->joining = FALSE;
+  time = (g_get_monotonic_time () - self->join_start) * GST_USECOND;
+
+  GST_INFO_OBJECT (self, "Joined %" GST_STIME_FORMAT " from the timeline in %"
+      GST_TIME_FORMAT, GST_STIME_ARGS (error), GST_TIME_ARGS (time));
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "error",
+      g_variant_new_int64 (error));
+  g_variant_builder_add (&builder, "{sv}", "time",
+      g_variant_new_uint64 (time));
+  g_variant_builder_add (&builder, "{sv}", "seek-time",
+      g_variant_new_uint64 (seek_time));
+
+  if (self->join_result)
+    g_variant_unref (self->join_result);
+  self->join_result = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+  /* We might be on a streaming thread */
+  g_idle_add_full (G_PRIORITY_DEFAULT, join_completed_idle,
+      g_object_ref (self), g_object_unref);
+}
+
+/* Call with join_lock held, when a seek completes. Returns how long it took,
+ * and updates our estimate for the URI. */
+static GstClockTime
+update_seek_time (GstSyncClient * self)
+{
+  GstClockTime taken, *estimate;
+
+  taken = (g_get_monotonic_time () - self->seek_start) * GST_USECOND;
+
+  if (!self->seek_uri)
+    return taken;
+
+  estimate = g_hash_table_lookup (self->seek_times, self->seek_uri);
+
+  if (estimate) {
+    /* Seek times vary a fair bit (caching, where the keyframes are), so
+     * smooth them a little */
+    *estimate = (3 * *estimate + taken) / 4;
+  } else {
+    estimate = g_new (GstClockTime, 1);
+    *estimate = taken;
+    g_hash_table_insert (self->seek_times, g_strdup (self->seek_uri),
+        estimate);
+  }
+
+  self->last_seek_time = *estimate;
+
+  GST_DEBUG_OBJECT (self, "Seek took %" GST_TIME_FORMAT ", expecting %"
+      GST_TIME_FORMAT " for %s", GST_TIME_ARGS (taken),
+      GST_TIME_ARGS (*estimate), self->seek_uri);
+
+  return taken;
+}
+
+/* Seeks to where @position will be once the seek completes. We might not
+ * have seeked in this URI before, in which case the last URI we did is the
+ * best guess we have. */
+static gboolean
+seek_ahead (GstSyncClient * self, GstClockTime position)
+{
+  GstClockTime *estimate;
+
+  g_mutex_lock (&self->join_lock);
+
+  g_free (self->seek_uri);
+  self->seek_uri = g_strdup (self->current_uri);
+
+  estimate = self->seek_uri ?
+    g_hash_table_lookup (self->seek_times, self->seek_uri) : NULL;
+  position += estimate ? *estimate : self->last_seek_time;
+
+  self->seek_start = g_get_monotonic_time ();
+
+  g_mutex_unlock (&self->join_lock);
+
+  GST_INFO_OBJECT (self, "Seeking to %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (position));
+
+  return gst_element_seek_simple (GST_ELEMENT (self->pipeline),
+      GST_FORMAT_TIME, self->seek_flags | GST_SEEK_FLAG_FLUSH, position);
+}
+
+/* Call with info_lock held. Seeks to where the timeline says we should be,
+ * unless we're already close enough. */
+static void
+seek_to_timeline (GstSyncClient * self)
+{
+  GstClockTime now;
+  gint64 cur_pos;
+
+  now = gst_clock_get_time (get_playback_clock (self));
+  g_atomic_int_set (&self->seek_state, IN_SEEK);
+
+  cur_pos = now -
+    gst_sync_server_info_get_base_time (self->info) -
+    gst_sync_server_info_get_base_time_offset (self->info);
+
+  if (cur_pos > (gint64) self->seek_tolerance) {
+    /* Let's seek ahead to prevent excessive clipping */
+    if (!seek_ahead (self, cur_pos)) {
+      GST_WARNING_OBJECT (self, "Could not perform seek");
+
+      g_atomic_int_set (&self->seek_state, DONE_SEEK);
+      update_startup_time (self);
+
+      g_mutex_lock (&self->join_lock);
+      self->joining = FALSE;
+      g_mutex_unlock (&self->join_lock);
+    }
+  } else {
+    /* For the seek case, the base time will be set after the seek */
+    GST_INFO_OBJECT (self, "Not seeking as we're within the threshold");
+    g_atomic_int_set (&self->seek_state, DONE_SEEK);
+    update_startup_time (self);
+
+    /* Whatever of the track has gone by gets clipped */
+    g_mutex_lock (&self->join_lock);
+    finish_join (self, -cur_pos, 0);
+    g_mutex_unlock (&self->join_lock);
+  }
+}
+
+static void
+free_join_probes (GSList * probes)
+{
+  GSList *l;
+
+  for (l = probes; l; l = l->next) {
+    JoinProbe *probe = l->data;
+
+    /* This lets through whatever was blocked */
+    gst_pad_remove_probe (probe->pad, probe->id);
+    gst_object_unref (probe->pad);
+    g_free (probe);
+  }
+
+  g_slist_free (probes);
+}
+
+/* Forget about any join in progress, letting data through */
+static void
+stop_join (GstSyncClient * self)
+{
+  GSList *probes;
+
+  g_mutex_lock (&self->join_lock);
+
+  probes = self->join_probes;
+  self->join_probes = NULL;
+  self->join_pending = FALSE;
+  self->join_blocked = FALSE;
+  self->joining = FALSE;
+
+  g_mutex_unlock (&self->join_lock);
+
+  free_join_probes (probes);
+}
+
+/* Playback used to preroll from the start of the track, start playing, and
+ * then flush and seek to the join position, which meant decoding from two
+ * places and throwing one away. Instead, we block the first buffers that
+ * reach playsink (by which time the demuxer can seek), and do a single seek
+ * from there before anything prerolls. */
+static void
+start_join (GstSyncClient * self)
+{
+  stop_join (self);
+
+  g_mutex_lock (&self->join_lock);
+  self->join_pending = self->can_join_seek;
+  self->joining = TRUE;
+  self->join_start = g_get_monotonic_time ();
+  g_mutex_unlock (&self->join_lock);
+}
+
+/* Call with info_lock held. Does the join seek if we're blocked waiting for it
+ * and know what time it is. */
+static void
+join_seek (GstSyncClient * self)
+{
+  GSList *probes;
+
+  g_mutex_lock (&self->join_lock);
+
+  if (!self->join_blocked || !self->clock_ready) {
+    g_mutex_unlock (&self->join_lock);
+    return;
+  }
+
+  probes = self->join_probes;
+  self->join_probes = NULL;
+  self->join_pending = FALSE;
+  self->join_blocked = FALSE;
+
+  /* Time spent waiting for the clock isn't time it takes us to preroll */
+  self->preroll_start += g_get_monotonic_time () - self->join_block_time;
+
+  g_mutex_unlock (&self->join_lock);
+
+  if (g_atomic_int_get (&self->seek_state) == NEED_SEEK)
+    seek_to_timeline (self);
+
+  /* Data from before the seek was flushed, so this lets through data from
+   * the new position (or the old one, if we didn't need to seek) */
+  free_join_probes (probes);
+}
+
+static gboolean
+join_seek_idle (gpointer user_data)
+{
+  GstSyncClient *self = GST_SYNC_CLIENT (user_data);
+
+  g_mutex_lock (&self->info_lock);
+  join_seek (self);
+  g_mutex_unlock (&self->info_lock);
+
+  return G_SOURCE_REMOVE;
+}
+
+static GstPadProbeReturn
+join_probe_cb (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstSyncClient *self = GST_SYNC_CLIENT (user_data);
+
+  g_mutex_lock (&self->join_lock);
+
+  if (self->join_pending && !self->join_blocked) {
+    GST_DEBUG_OBJECT (self, "Got data, ready to seek");
+
+    self->join_blocked = TRUE;
+    self->join_block_time = g_get_monotonic_time ();
+
+    /* We can't seek from the streaming thread we're blocking */
+    g_idle_add_full (G_PRIORITY_DEFAULT, join_seek_idle, g_object_ref (self),
+        g_object_unref);
+  }
+
+  g_mutex_unlock (&self->join_lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+playsink_pad_added_cb (GstElement * playsink, GstPad * pad,
+    gpointer user_data)
+{
+  GstSyncClient *self = GST_SYNC_CLIENT (user_data);
+  JoinProbe *probe;
+
+  if (!GST_PAD_IS_SINK (pad))
+    return;
+
+  g_mutex_lock (&self->join_lock);
+
+  if (self->join_pending) {
+    probe = g_new0 (JoinProbe, 1);
+    probe->pad = gst_object_ref (pad);
+    probe->id = gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BLOCK |
+        GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+        join_probe_cb, self, NULL);
+
+    self->join_probes = g_slist_prepend (self->join_probes, probe);
+  }
+
+  g_mutex_unlock (&self->join_lock);
+}
+
+/* Call with info_lock held */
+static void
+start_playback (GstSyncClient * self)
+{
+  if (gst_sync_server_info_get_stopped (self->info) ||
+      gst_sync_server_info_get_paused (self->info))
+    return;
+
+  set_base_time (self);
+  gst_element_set_state (GST_ELEMENT (self->pipeline), GST_STATE_PLAYING);
+}
+
+/* Call with info_lock held. Works out what, if anything, playbin should play
+ * without a gap after the current track. */
+static void
+update_next_track (GstSyncClient * self)
+{
+  gchar **uris, *next_uri = NULL;
+  guint64 current_track, n_tracks, *durations;
+  GVariant *playlist;
+
+  playlist = gst_sync_server_info_get_playlist (self->info);
+  gst_sync_server_playlist_get_tracks (playlist, &uris, &durations, &n_tracks);
+  current_track = gst_sync_server_playlist_get_current_track (playlist);
+  g_variant_unref (playlist);
+
+  /* If the server leaves a gap between tracks, we reload the pipeline in
+   * it. A latency change also needs a reload, so it waits for EOS. */
+  if (current_track + 1 < n_tracks &&
+      gst_sync_server_info_get_stream_start_delay (self->info) == 0 &&
+      gst_sync_server_info_get_pending_latency (self->info) == 0 &&
+      !gst_sync_server_info_get_stopped (self->info))
+    next_uri = g_strdup (uris[current_track + 1]);
+
+  gst_sync_server_playlist_free_tracks (uris, durations, n_tracks);
+
+  g_mutex_lock (&self->join_lock);
+  g_free (self->next_uri);
+  self->next_uri = next_uri;
+  g_mutex_unlock (&self->join_lock);
+}
+
 /* Call with info_lock held */
 static void
 update_pipeline (GstSyncClient * self, gboolean advance)
@@ -337,11 +893,27 @@ update_pipeline (GstSyncClient * self, gboolean advance)
         "playlist", playlist,
         "base-time-offset", base_time_offset,
         NULL);
+
+    /* The server switches latency at track boundaries, and so do we */
+    if (gst_sync_server_info_get_pending_latency (self->info)) {
+      g_object_set (self->info,
+          "latency", gst_sync_server_info_get_pending_latency (self->info),
+          "pending-latency", (guint64) 0,
+          NULL);
+    }
   }
 
   uri = uris[current_track];
   g_object_set (GST_OBJECT (self->pipeline), "uri", uri, NULL);
 
+  g_free (self->current_uri);
+  self->current_uri = g_strdup (uri);
+
+  /* Anything about-to-finish queued up is gone */
+  g_mutex_lock (&self->join_lock);
+  self->gapless_pending = FALSE;
+  g_mutex_unlock (&self->join_lock);
+
   gst_sync_server_playlist_free_tracks (uris, durations, n_tracks);
 
   gst_pipeline_set_latency (self->pipeline,
@@ -357,6 +929,9 @@ update_pipeline (GstSyncClient * self, gboolean advance)
     return;
   }
 
+  self->preroll_start = g_get_monotonic_time ();
+  start_join (self);
+
   switch (gst_element_set_state (GST_ELEMENT (self->pipeline),
         GST_STATE_PAUSED)) {
     case GST_STATE_CHANGE_FAILURE:
@@ -374,14 +949,556 @@ update_pipeline (GstSyncClient * self, gboolean advance)
   }
 
   self->seek_offset = 0;
+  self->position_correction = 0;
+  self->is_live = is_live;
   g_atomic_int_set (&self->seek_state, is_live ? DONE_SEEK : NEED_SEEK);
 
+  /* Nothing to seek in */
+  if (is_live)
+    stop_join (self);
+
+  update_next_track (self);
+
   /* We need to do PAUSED and PLAYING in separate steps so we don't have a race
-   * between us and reading seek_state in bus_cb() */
-  if (!gst_sync_server_info_get_paused (self->info)) {
-    set_base_time (self);
-    gst_element_set_state (GST_ELEMENT (self->pipeline), GST_STATE_PLAYING);
+   * between us and reading seek_state in bus_cb(). Until the clock is ready,
+   * we just preroll. */
+  if (self->clock_ready)
+    start_playback (self);
+}
+
+/* Call with info_lock held, when the track playbin queued up from
+ * about-to-finish starts. We're still running on the previous track's base
+ * time, so we move our idea of the timeline along to match. */
+static void
+advance_gapless (GstSyncClient * self)
+{
+  gchar **uris;
+  guint64 current_track, n_tracks, *durations, base_time_offset, duration;
+  GVariant *playlist;
+
+  playlist = gst_sync_server_info_get_playlist (self->info);
+  gst_sync_server_playlist_get_tracks (playlist, &uris, &durations, &n_tracks);
+  current_track = gst_sync_server_playlist_get_current_track (playlist);
+
+  if (current_track + 1 >= n_tracks)
+    goto done;
+
+  if (durations[current_track] != GST_CLOCK_TIME_NONE)
+    duration = durations[current_track];
+  else if (self->last_duration != GST_CLOCK_TIME_NONE)
+    duration = self->last_duration;
+  else {
+    /* As with update_pipeline(), wait for a reset from the server */
+    goto done;
+  }
+
+  current_track++;
+  base_time_offset =
+    gst_sync_server_info_get_base_time_offset (self->info) + duration;
+
+  GST_INFO_OBJECT (self, "Moved to track %lu without a gap", current_track);
+
+  g_object_set (self->info,
+      "playlist",
+      gst_sync_server_playlist_set_current_track (g_variant_ref (playlist),
+        current_track),
+      "base-time-offset", base_time_offset,
+      NULL);
+
+  /* The running time carries on from the last track, so this keeps the
+   * pipeline's base time where it is */
+  self->seek_offset -= duration;
+
+  g_free (self->current_uri);
+  self->current_uri = g_strdup (uris[current_track]);
+
+  if (!gst_element_query_duration (GST_ELEMENT (self->pipeline),
+        GST_FORMAT_TIME, &self->last_duration))
+    self->last_duration = GST_CLOCK_TIME_NONE;
+
+  update_next_track (self);
+
+done:
+  g_variant_unref (playlist);
+  gst_sync_server_playlist_free_tracks (uris, durations, n_tracks);
+}
+
+static void
+about_to_finish_cb (GstElement * playbin, gpointer user_data)
+{
+  GstSyncClient *self = GST_SYNC_CLIENT (user_data);
+
+  g_mutex_lock (&self->join_lock);
+
+  if (self->next_uri) {
+    GST_DEBUG_OBJECT (self, "Queueing up %s", self->next_uri);
+
+    g_object_set (playbin, "uri", self->next_uri, NULL);
+    self->gapless_pending = TRUE;
+  }
+
+  g_mutex_unlock (&self->join_lock);
+}
+
+/* A saved calibration is only meaningful if our monotonic clock hasn't been
+ * reset since, so we need to know if we've rebooted */
+static gchar *
+get_boot_id (void)
+{
+  gchar *boot_id = NULL;
+
+  if (g_file_get_contents ("/proc/sys/kernel/random/boot_id", &boot_id, NULL,
+        NULL))
+    g_strstrip (boot_id);
+
+  return boot_id;
+}
+
+static GstClock *
+make_local_clock (void)
+{
+  GstClock *clock;
+
+  clock = g_object_new (GST_TYPE_SYSTEM_CLOCK,
+      "name", "sync-client-local-clock",
+      "clock-type", GST_CLOCK_TYPE_MONOTONIC,
+      NULL);
+
+  /* So that we can slave it to the network clock */
+  GST_OBJECT_FLAG_SET (clock, GST_CLOCK_FLAG_CAN_SET_MASTER);
+
+  return clock;
+}
+
+/* Loads the last calibration of the local clock against the server's for the
+ * current server, if we have a usable one */
+static gboolean
+load_calibration (GstSyncClient * self, GstClockTime * internal,
+    GstClockTime * external, gdouble * rate)
+{
+  GKeyFile *keyfile;
+  GError *err = NULL;
+  gchar *boot_id = NULL, *saved_boot_id = NULL;
+  gint64 saved;
+  gboolean ret = FALSE;
+
+  keyfile = g_key_file_new ();
+
+  if (!g_key_file_load_from_file (keyfile, self->calibration_file,
+        G_KEY_FILE_NONE, NULL) ||
+      !g_key_file_has_group (keyfile, self->calibration_key))
+    goto done;
+
+  saved = g_key_file_get_int64 (keyfile, self->calibration_key, "saved", &err);
+  if (err)
+    goto done;
+
+  if (g_get_real_time () - saved > CALIBRATION_MAX_AGE) {
+    GST_INFO_OBJECT (self, "Saved clock calibration is too old");
+    goto done;
+  }
+
+  boot_id = get_boot_id ();
+  saved_boot_id = g_key_file_get_string (keyfile, self->calibration_key,
+      "boot-id", NULL);
+  if (g_strcmp0 (boot_id, saved_boot_id) != 0) {
+    GST_INFO_OBJECT (self, "Saved clock calibration is from another boot");
+    goto done;
+  }
+
+  *internal = g_key_file_get_uint64 (keyfile, self->calibration_key,
+      "internal", &err);
+  if (!err)
+    *external = g_key_file_get_uint64 (keyfile, self->calibration_key,
+        "external", &err);
+  if (!err)
+    *rate = g_key_file_get_double (keyfile, self->calibration_key, "rate",
+        &err);
+  if (err || *rate <= 0)
+    goto done;
+
+  ret = TRUE;
+
+done:
+  if (err) {
+    GST_WARNING_OBJECT (self, "Invalid saved clock calibration: %s",
+        err->message);
+    g_error_free (err);
+  }
+
+  g_free (boot_id);
+  g_free (saved_boot_id);
+  g_key_file_unref (keyfile);
+
+  return ret;
+}
+
+/* Saves the current mapping from the local clock to the server's */
+static void
+save_calibration (GstSyncClient * self, gdouble rate)
+{
+  GKeyFile *keyfile;
+  GError *err = NULL;
+  GstClockTime internal, external;
+  gchar *boot_id, *dir;
+
+  internal = gst_clock_get_internal_time (self->local_clock);
+  external = gst_clock_get_time (self->clock);
+
+  keyfile = g_key_file_new ();
+  /* Keep calibrations for other servers */
+  g_key_file_load_from_file (keyfile, self->calibration_file,
+      G_KEY_FILE_KEEP_COMMENTS, NULL);
+
+  g_key_file_set_uint64 (keyfile, self->calibration_key, "internal",
+      internal);
+  g_key_file_set_uint64 (keyfile, self->calibration_key, "external",
+      external);
+  g_key_file_set_double (keyfile, self->calibration_key, "rate", rate);
+  g_key_file_set_int64 (keyfile, self->calibration_key, "saved",
+      g_get_real_time ());
+
+  boot_id = get_boot_id ();
+  if (boot_id)
+    g_key_file_set_string (keyfile, self->calibration_key, "boot-id",
+        boot_id);
+  else
+    g_key_file_remove_key (keyfile, self->calibration_key, "boot-id", NULL);
+
+  dir = g_path_get_dirname (self->calibration_file);
+  g_mkdir_with_parents (dir, 0755);
+
+  if (!g_key_file_save_to_file (keyfile, self->calibration_file, &err)) {
+    GST_WARNING_OBJECT (self, "Could not save clock calibration: %s",
+        err->message);
+    g_error_free (err);
+  }
+
+  g_free (dir);
+  g_free (boot_id);
+  g_key_file_unref (keyfile);
+}
+
+/* Creates a clock that runs on our last known calibration against the server,
+ * so we can start playing before the network clock has synchronised */
+static gboolean
+seed_clock (GstSyncClient * self)
+{
+  GstClockTime internal, external;
+  gdouble rate;
+
+  if (!self->local_clock || !GST_IS_NET_CLIENT_CLOCK (self->clock))
+    return FALSE;
+
+  if (!load_calibration (self, &internal, &external, &rate))
+    return FALSE;
+
+  GST_INFO_OBJECT (self, "Seeding clock from saved calibration (rate %f)",
+      rate);
+
+  gst_clock_set_calibration (self->local_clock, internal, external,
+      rate * GST_SECOND, GST_SECOND);
+
+  return TRUE;
+}
+
+/* Call with info_lock held */
+static GstClockTime
+get_min_poll_interval (GstSyncClient * self)
+{
+  if (!self->info)
+    return 0;
+
+  return gst_sync_server_info_get_clock_min_poll_interval (self->info);
+}
+
+static void
+set_poll_interval (GstSyncClient * self, GstClockTime interval)
+{
+  GstClockTime min_interval;
+
+  g_mutex_lock (&self->info_lock);
+  min_interval = get_min_poll_interval (self);
+  g_mutex_unlock (&self->info_lock);
+
+  /* The server's budget wins over anything we'd like to do */
+  interval = MAX (interval, min_interval);
+
+  if (interval == self->poll_interval)
+    return;
+
+  GST_DEBUG_OBJECT (self, "Polling clock every %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (interval));
+
+  self->poll_interval = interval;
+  g_object_set (self->clock, "timeout", interval, NULL);
+}
+
+/* The most often we poll when adapting. Without a budget from the server to
+ * tell us what it can take, we never poll faster than the clock does by
+ * itself, so that adapting only ever takes load off the time provider. */
+static GstClockTime
+get_poll_floor (GstSyncClient * self)
+{
+  GstClockTime lowest;
+  GParamSpec *pspec;
+
+  g_mutex_lock (&self->info_lock);
+  lowest = get_min_poll_interval (self);
+  g_mutex_unlock (&self->info_lock);
+
+  if (lowest == 0) {
+    pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (self->clock),
+        "timeout");
+    lowest = G_PARAM_SPEC_UINT64 (pspec)->default_value;
+  }
+
+  return MAX (lowest, MIN_POLL_INTERVAL);
+}
+
+/* Polls the clock often when the round trip time is noisy or the clock is
+ * still being corrected by a lot, and backs off exponentially while things are
+ * stable, so that an idle, well synchronised client costs the server very
+ * little. */
+static void
+adapt_poll_interval (GstSyncClient * self, const GstStructure * st,
+    gboolean synchronised)
+{
+  GstClockTime rtt = GST_CLOCK_TIME_NONE, interval, lowest;
+  gint64 discont = 0, err;
+  gboolean stable;
+
+  if (!self->adaptive_poll || self->fast_polling ||
+      !GST_IS_NET_CLIENT_CLOCK (self->clock))
+    return;
+
+  gst_structure_get_clock_time (st, "rtt", &rtt);
+  /* How far this observation moved the clock, i.e. how wrong we were */
+  gst_structure_get_int64 (st, "discontinuity", &discont);
+
+  if (!GST_CLOCK_TIME_IS_VALID (rtt))
+    return;
+
+  if (self->rtt_avg == 0) {
+    self->rtt_avg = rtt;
+    self->rtt_dev = rtt / 2;
+  }
+
+  /* Same smoothing as TCP uses for its retransmission timer */
+  err = (gint64) rtt - self->rtt_avg;
+  stable = synchronised &&
+    ABS (err) <= MAX (4 * self->rtt_dev, NOISE_FLOOR) &&
+    ABS (discont) <= MAX (2 * self->rtt_dev, NOISE_FLOOR);
+
+  self->rtt_avg += err / 8;
+  self->rtt_dev += (ABS (err) - self->rtt_dev) / 4;
+
+  lowest = get_poll_floor (self);
+
+  if (!GST_CLOCK_TIME_IS_VALID (self->poll_interval))
+    interval = lowest;
+  else
+    interval = self->poll_interval;
+
+  if (!stable) {
+    self->stable_polls = 0;
+    interval = lowest;
+  } else if (++self->stable_polls >= STABLE_POLLS) {
+    self->stable_polls = 0;
+    interval = MIN (interval * 2, MAX_POLL_INTERVAL);
+  }
+
+  set_poll_interval (self, MAX (interval, lowest));
+}
+
+static void
+update_clock_stats (GstSyncClient * self, const GstStructure * st)
+{
+  GVariantBuilder builder;
+  GVariant *stats, *old_stats;
+  gboolean synchronised = FALSE;
+  GstClockTime rtt = GST_CLOCK_TIME_NONE;
+  gint64 offset = 0, now;
+  gdouble rate = 1.0, r_squared = 0.0;
+
+  gst_structure_get_boolean (st, "synchronised", &synchronised);
+  gst_structure_get_clock_time (st, "rtt-average", &rtt);
+  gst_structure_get_int64 (st, "local-clock-offset", &offset);
+  gst_structure_get_double (st, "rate", &rate);
+  gst_structure_get_double (st, "r-squared", &r_squared);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "synchronised",
+      g_variant_new_boolean (synchronised));
+  g_variant_builder_add (&builder, "{sv}", "rtt", g_variant_new_uint64 (rtt));
+  g_variant_builder_add (&builder, "{sv}", "offset",
+      g_variant_new_int64 (offset));
+  g_variant_builder_add (&builder, "{sv}", "rate", g_variant_new_double (rate));
+  g_variant_builder_add (&builder, "{sv}", "r-squared",
+      g_variant_new_double (r_squared));
+
+  /* Let the server see how well we're keeping up with the timeline too */
+  g_mutex_lock (&self->stats_lock);
+  if (GST_CLOCK_TIME_IS_VALID (self->measured_latency)) {
+    g_variant_builder_add (&builder, "{sv}", "latency",
+        g_variant_new_uint64 (self->measured_latency));
+  }
+  g_variant_builder_add (&builder, "{sv}", "position-error",
+      g_variant_new_int64 (self->position_error));
+  g_variant_builder_add (&builder, "{sv}", "position-nudges",
+      g_variant_new_uint64 (self->position_nudges));
+  g_variant_builder_add (&builder, "{sv}", "position-seeks",
+      g_variant_new_uint64 (self->position_seeks));
+  g_mutex_unlock (&self->stats_lock);
+
+  stats = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+  g_mutex_lock (&self->stats_lock);
+  old_stats = self->clock_stats;
+  self->clock_stats = g_variant_ref (stats);
+  g_mutex_unlock (&self->stats_lock);
+
+  if (old_stats)
+    g_variant_unref (old_stats);
+
+  g_signal_emit_by_name (self, "clock-stats", stats);
+
+  /* The clock posts statistics on every poll, so we only pass them on
+   * periodically, or when we gain or lose synchronisation */
+  now = g_get_monotonic_time ();
+
+  if (self->client && self->stats_interval > 0 &&
+      (synchronised != self->last_stats_synchronised ||
+       now - self->last_stats_report >=
+         (gint64) self->stats_interval * G_TIME_SPAN_MILLISECOND)) {
+    gst_sync_control_client_report_stats (self->client, stats);
+
+    self->last_stats_report = now;
+    self->last_stats_synchronised = synchronised;
+  }
+
+  if (self->local_clock && synchronised &&
+      (self->last_calibration_save == 0 ||
+       now - self->last_calibration_save >= CALIBRATION_SAVE_INTERVAL)) {
+    save_calibration (self, rate);
+    self->last_calibration_save = now;
+  }
+
+  adapt_poll_interval (self, st, synchronised);
+
+  g_variant_unref (stats);
+}
+
+/* Called once we've prerolled */
+static void
+measure_latency (GstSyncClient * self)
+{
+  GstQuery *query;
+  GstClockTime min_latency = 0, latency;
+  gboolean live;
+
+  query = gst_query_new_latency ();
+  if (gst_element_query (GST_ELEMENT (self->pipeline), query))
+    gst_query_parse_latency (query, &live, &min_latency, NULL);
+  gst_query_unref (query);
+
+  if (!GST_CLOCK_TIME_IS_VALID (min_latency))
+    min_latency = 0;
+
+  latency = min_latency +
+    (g_get_monotonic_time () - self->preroll_start) * GST_USECOND;
+
+  GST_DEBUG_OBJECT (self, "Measured latency %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (latency));
+
+  g_mutex_lock (&self->stats_lock);
+
+  /* Keep the worst we've seen, a track that was quick to start doesn't mean
+   * the next one will be */
+  if (!GST_CLOCK_TIME_IS_VALID (self->measured_latency) ||
+      latency > self->measured_latency) {
+    self->measured_latency = latency;
+    /* Report with the next clock statistics */
+    self->last_stats_report = 0;
+  } else
+    latency = GST_CLOCK_TIME_NONE;
+
+  g_mutex_unlock (&self->stats_lock);
+
+  /* Other clocks don't post statistics for us to report with, so send it
+   * now */
+  if (GST_CLOCK_TIME_IS_VALID (latency) && self->client &&
+      self->stats_interval > 0 && !GST_IS_NET_CLIENT_CLOCK (self->clock)) {
+    GVariantBuilder builder;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add (&builder, "{sv}", "latency",
+        g_variant_new_uint64 (latency));
+    gst_sync_control_client_report_stats (self->client,
+        g_variant_builder_end (&builder));
+  }
+}
+
+static void
+start_fast_polling (GstSyncClient * self)
+{
+  GstClockTime interval;
+
+  if (!GST_IS_NET_CLIENT_CLOCK (self->clock))
+    return;
+
+  g_object_get (self->clock,
+      "timeout", &self->saved_timeout,
+      "minimum-update-interval", &self->saved_min_update_interval,
+      NULL);
+
+  /* Even while converging, we stay within the server's polling budget. We're
+   * called with info_lock held. */
+  interval = MAX (FAST_POLL_INTERVAL, get_min_poll_interval (self));
+
+  g_object_set (self->clock,
+      "timeout", interval,
+      "minimum-update-interval", MIN (interval,
+        self->saved_min_update_interval),
+      NULL);
+
+  self->fast_polling = TRUE;
+}
+
+static void
+stop_fast_polling (GstSyncClient * self)
+{
+  if (!self->fast_polling)
+    return;
+
+  /* Back off to the normal poll rate now that we've converged, after which
+   * the adaptive polling takes over if enabled */
+  g_object_set (self->clock,
+      "timeout", self->saved_timeout,
+      "minimum-update-interval", self->saved_min_update_interval,
+      NULL);
+
+  self->fast_polling = FALSE;
+  self->poll_interval = self->saved_timeout;
+}
+
+/* Whether the clock is close enough to the server's to start playback, given
+ * the average round trip time to the server */
+static gboolean
+clock_converged (GstSyncClient * self, GstClockTime rtt)
+{
+  /* We can't know the server's time any better than half the round trip */
+  if (GST_CLOCK_TIME_IS_VALID (rtt) && rtt / 2 <= self->sync_error_bound)
+    return TRUE;
+
+  if (g_get_monotonic_time () - self->sync_start > CONVERGENCE_TIMEOUT) {
+    GST_WARNING_OBJECT (self, "Clock did not get within %" GST_TIME_FORMAT
+        " (round trip %" GST_TIME_FORMAT "), starting anyway",
+        GST_TIME_ARGS (self->sync_error_bound), GST_TIME_ARGS (rtt));
+    return TRUE;
   }
+
+  return FALSE;
 }
 
 static gboolean
@@ -392,28 +1509,61 @@ bus_cb (GstBus * bus, GstMessage * message, gpointer user_data)
   switch (GST_MESSAGE_TYPE (message)) {
     case GST_MESSAGE_ELEMENT: {
       const GstStructure *st;
-
-      if (self->synchronised)
-        break;
+      gboolean synchronised = FALSE;
+      GstClockTime rtt = GST_CLOCK_TIME_NONE;
 
       st = gst_message_get_structure (message);
-      if (!gst_structure_has_name (st, "gst-netclock-statistics"))
+      if (gst_structure_has_name (st, "gst-netclock-statistics")) {
+        update_clock_stats (self, st);
+        gst_structure_get_boolean (st, "synchronised", &synchronised);
+        gst_structure_get_clock_time (st, "rtt-average", &rtt);
+      } else if (gst_structure_has_name (st, CLOCK_SYNCED_MESSAGE)) {
+        /* Nothing better to go on for PTP */
+        synchronised = TRUE;
+        rtt = 0;
+      }
+
+      /* We only need to start playback the first time around */
+      if (self->synchronised || !synchronised)
         break;
 
-      gst_structure_get_boolean (st, "synchronised", &self->synchronised);
-      if (!self->synchronised)
+      if (self->fast_start && !clock_converged (self, rtt))
         break;
 
+      self->synchronised = TRUE;
+
       if (!gst_clock_wait_for_sync (self->clock, 10 * GST_SECOND)) {
         GST_ERROR_OBJECT (self, "Could not synchronise clock");
         self->synchronised = FALSE;
         break;
       }
 
+      stop_fast_polling (self);
+
+      if (self->seeded) {
+        /* We're already playing on the saved calibration, and from here on
+         * we refine that against the network clock */
+        GST_INFO_OBJECT (self, "Clock is synchronised, following it");
+        gst_clock_set_master (self->local_clock, self->clock);
+        break;
+      }
+
       GST_INFO_OBJECT (self, "Clock is synchronised, starting playback");
 
       g_mutex_lock (&self->info_lock);
-      update_pipeline (self, FALSE);
+
+      self->clock_ready = TRUE;
+
+      /* We might have been holding back prerolling until we knew where to
+       * seek to */
+      join_seek (self);
+
+      if (self->fast_start) {
+        /* We've been prerolling all this while, so just start playing */
+        start_playback (self);
+      } else
+        update_pipeline (self, FALSE);
+
       g_mutex_unlock (&self->info_lock);
 
       break;
@@ -421,62 +1571,47 @@ bus_cb (GstBus * bus, GstMessage * message, gpointer user_data)
 
     case GST_MESSAGE_STATE_CHANGED: {
       GstState old_state, new_state;
-      GstClockTime now;
-      gint64 cur_pos;
 
-      if (g_atomic_int_get (&self->seek_state) != NEED_SEEK ||
-          GST_MESSAGE_SRC (message) != GST_OBJECT (self->pipeline))
+      if (GST_MESSAGE_SRC (message) != GST_OBJECT (self->pipeline))
         break;
 
       gst_message_parse_state_changed (message, &old_state, &new_state, NULL);
 
-      if (old_state == GST_STATE_READY && new_state == GST_STATE_PAUSED) {
+      if (old_state == GST_STATE_READY && new_state == GST_STATE_PAUSED &&
+          !self->is_live) {
         GstElement *audio_sink;
 
         g_object_get (G_OBJECT (self->pipeline), "audio-sink", &audio_sink,
             NULL);
 
         g_object_set (G_OBJECT (audio_sink), "drift-tolerance", 10000 /* µs */,
-            "alignment-threshold", 10 * GST_MSECOND, NULL);
-
-        gst_object_unref (audio_sink);
-      }
-
-      if (old_state != GST_STATE_PAUSED && new_state != GST_STATE_PLAYING)
-        break;
-
-      now = gst_clock_get_time (self->clock);
-      g_atomic_int_set (&self->seek_state, IN_SEEK);
-
-      g_mutex_lock (&self->info_lock);
-
-      cur_pos = now -
-        gst_sync_server_info_get_base_time (self->info) -
-        gst_sync_server_info_get_base_time_offset (self->info);
+            "alignment-threshold", 10 * GST_MSECOND, NULL);
 
-      if (cur_pos > DEFAULT_SEEK_TOLERANCE) {
-        /* Let's seek ahead to prevent excessive clipping */
-        GST_INFO_OBJECT (self, "Seeking: %lu", cur_pos);
+        /* Track the clock continuously rather than snapping back at the
+         * drift tolerance */
+        if (self->use_audio_servo)
+          gst_sync_audio_servo_attach (self->audio_servo, audio_sink);
 
-        if (!gst_element_seek_simple (GST_ELEMENT (self->pipeline),
-              GST_FORMAT_TIME, GST_SEEK_FLAG_SNAP_AFTER |
-              GST_SEEK_FLAG_KEY_UNIT | GST_SEEK_FLAG_FLUSH,
-              cur_pos)) {
-          GST_WARNING_OBJECT (self, "Could not perform seek");
+        measure_latency (self);
 
-          g_atomic_int_set (&self->seek_state, DONE_SEEK);
-        }
-      } else {
-        /* For the seek case, the base time will be set after the seek */
-        GST_INFO_OBJECT (self, "Not seeking as we're within the threshold");
-        g_atomic_int_set (&self->seek_state, DONE_SEEK);
+        gst_object_unref (audio_sink);
       }
 
-      g_mutex_unlock (&self->info_lock);
+      if (old_state != GST_STATE_PAUSED && new_state != GST_STATE_PLAYING)
+        break;
 
       gst_element_query_duration (GST_ELEMENT (self->pipeline),
           GST_FORMAT_TIME, &self->last_duration);
 
+      /* Normally we've seeked before prerolling (see start_join()), but if we
+       * couldn't, do it now that we're playing */
+      if (g_atomic_int_get (&self->seek_state) != NEED_SEEK)
+        break;
+
+      g_mutex_lock (&self->info_lock);
+      seek_to_timeline (self);
+      g_mutex_unlock (&self->info_lock);
+
       break;
     }
 
@@ -488,20 +1623,61 @@ bus_cb (GstBus * bus, GstMessage * message, gpointer user_data)
        * will not guarantee that, and (b) setting the base time as early as
        * possible means we'll start rendering correctly synchronised buffers
        * sooner */
+      GstClockTime seek_time;
+      gint64 expected = 0;
+      gboolean have_position;
+
       if (g_atomic_int_get (&self->seek_state) != IN_SEEK)
         break;
 
-      if (gst_element_query_position (GST_ELEMENT (self->pipeline),
-            GST_FORMAT_TIME, &self->seek_offset)) {
+      have_position = gst_element_query_position (GST_ELEMENT (self->pipeline),
+            GST_FORMAT_TIME, &self->seek_offset);
+
+      if (have_position) {
         GST_INFO_OBJECT (self, "Adding offset: %lu", self->seek_offset);
 
         g_mutex_lock (&self->info_lock);
         set_base_time (self);
+        expected = gst_clock_get_time (get_playback_clock (self)) -
+          gst_sync_server_info_get_base_time (self->info) -
+          gst_sync_server_info_get_base_time_offset (self->info);
         g_mutex_unlock (&self->info_lock);
       }
 
+      g_mutex_lock (&self->join_lock);
+      seek_time = update_seek_time (self);
+      if (have_position)
+        finish_join (self, self->seek_offset - expected, seek_time);
+      else
+        self->joining = FALSE;
+      g_mutex_unlock (&self->join_lock);
+
       g_atomic_int_set (&self->seek_state, DONE_SEEK);
+      update_startup_time (self);
+
+      break;
+    }
+
+    case GST_MESSAGE_STREAM_START: {
+      gboolean gapless_pending;
+
+      g_mutex_lock (&self->join_lock);
+      gapless_pending = self->gapless_pending;
+      self->gapless_pending = FALSE;
+      g_mutex_unlock (&self->join_lock);
+
+      if (gapless_pending) {
+        g_mutex_lock (&self->info_lock);
+        advance_gapless (self);
+        g_mutex_unlock (&self->info_lock);
+      }
+
+      break;
+    }
 
+    case GST_MESSAGE_DURATION_CHANGED: {
+      gst_element_query_duration (GST_ELEMENT (self->pipeline),
+          GST_FORMAT_TIME, &self->last_duration);
       break;
     }
 
@@ -531,6 +1707,187 @@ bus_cb (GstBus * bus, GstMessage * message, gpointer user_data)
   return TRUE;
 }
 
+/* Call with stats_lock held */
+static GVariant *
+get_position_stats (GstSyncClient * self)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "error",
+      g_variant_new_int64 (self->position_error));
+  g_variant_builder_add (&builder, "{sv}", "nudges",
+      g_variant_new_uint64 (self->position_nudges));
+  g_variant_builder_add (&builder, "{sv}", "seeks",
+      g_variant_new_uint64 (self->position_seeks));
+
+  if (self->use_audio_servo) {
+    gint64 audio_error;
+
+    g_object_get (self->audio_servo, "error", &audio_error, NULL);
+    g_variant_builder_add (&builder, "{sv}", "audio-error",
+        g_variant_new_int64 (audio_error));
+  }
+
+  return g_variant_builder_end (&builder);
+}
+
+/* Periodically compares the position we're rendering with the position the
+ * server's timeline says we should be at. Sinks can fall behind (underruns,
+ * slow decoding, audio clock slaving getting it wrong), and nothing else
+ * would catch that once we've started playing. */
+static gboolean
+check_position (gpointer user_data)
+{
+  GstSyncClient *self = GST_SYNC_CLIENT (user_data);
+  GstElement *pipeline = GST_ELEMENT (self->pipeline);
+  GstState state;
+  GstClockTime now;
+  gint64 position, expected, error;
+  gboolean ready;
+
+  if (g_atomic_int_get (&self->seek_state) != DONE_SEEK || self->is_live)
+    return G_SOURCE_CONTINUE;
+
+  if (gst_element_get_state (pipeline, &state, NULL, 0) !=
+      GST_STATE_CHANGE_SUCCESS || state != GST_STATE_PLAYING)
+    return G_SOURCE_CONTINUE;
+
+  if (!gst_element_query_position (pipeline, GST_FORMAT_TIME, &position))
+    return G_SOURCE_CONTINUE;
+
+  now = gst_clock_get_time (get_playback_clock (self));
+
+  g_mutex_lock (&self->info_lock);
+
+  ready = self->clock_ready;
+  /* Sinks report the position as of now minus the latency */
+  expected = now -
+    gst_sync_server_info_get_base_time (self->info) -
+    gst_sync_server_info_get_base_time_offset (self->info) -
+    gst_pipeline_get_latency (self->pipeline);
+
+  g_mutex_unlock (&self->info_lock);
+
+  if (!ready || expected < 0)
+    return G_SOURCE_CONTINUE;
+
+  /* Positive if we're ahead of everyone else */
+  error = position - expected;
+
+  g_mutex_lock (&self->stats_lock);
+
+  /* Queries are a little noisy, so smooth the error a bit */
+  if (self->have_position_error)
+    self->position_error += (error - self->position_error) / 4;
+  else
+    self->position_error = error;
+  self->have_position_error = TRUE;
+
+  if (ABS (error) > (gint64) self->seek_tolerance) {
+    /* Too far off to fix without a glitch anyway, so jump to the right place
+     * and let the ASYNC_DONE handling fix up the base time */
+    GST_INFO_OBJECT (self, "Position is off by %" GST_STIME_FORMAT
+        ", seeking to %" GST_TIME_FORMAT, GST_STIME_ARGS (error),
+        GST_TIME_ARGS (expected));
+
+    self->position_seeks++;
+    self->have_position_error = FALSE;
+    g_mutex_unlock (&self->stats_lock);
+
+    g_mutex_lock (&self->info_lock);
+    self->position_correction = 0;
+    g_mutex_unlock (&self->info_lock);
+
+    g_atomic_int_set (&self->seek_state, IN_SEEK);
+
+    if (!seek_ahead (self, expected)) {
+      GST_WARNING_OBJECT (self, "Could not perform corrective seek");
+      g_atomic_int_set (&self->seek_state, DONE_SEEK);
+    }
+  } else if (ABS (self->position_error) > POSITION_ERROR_THRESHOLD) {
+    /* Moving the base time makes the sinks clip or insert to catch up */
+    GST_INFO_OBJECT (self, "Position is off by %" GST_STIME_FORMAT
+        ", adjusting base time", GST_STIME_ARGS (self->position_error));
+
+    g_mutex_lock (&self->info_lock);
+    self->position_correction += self->position_error;
+    set_base_time (self);
+    g_mutex_unlock (&self->info_lock);
+
+    self->position_nudges++;
+    self->have_position_error = FALSE;
+    g_mutex_unlock (&self->stats_lock);
+  } else
+    g_mutex_unlock (&self->stats_lock);
+
+  g_object_notify (G_OBJECT (self), "position-stats");
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+post_clock_synced (GstSyncClient * self)
+{
+  GstBus *bus;
+
+  bus = gst_pipeline_get_bus (self->pipeline);
+  gst_bus_post (bus, gst_message_new_element (GST_OBJECT (self->clock),
+        gst_structure_new_empty (CLOCK_SYNCED_MESSAGE)));
+  gst_object_unref (bus);
+}
+
+static void
+clock_synced_cb (GstClock * clock, gboolean synced, gpointer user_data)
+{
+  GstSyncClient *self = GST_SYNC_CLIENT (user_data);
+
+  /* This is called from the clock's thread, so let bus_cb() take it from
+   * here */
+  if (synced)
+    post_clock_synced (self);
+}
+
+static GstClock *
+make_clock (GstSyncClient * self)
+{
+  GstClock *clock = NULL;
+  gchar *clock_addr;
+
+  clock_addr = gst_sync_server_info_get_clock_address (self->info);
+
+  switch (gst_sync_server_info_get_clock_type (self->info)) {
+    case GST_SYNC_SERVER_CLOCK_TYPE_NET:
+      clock = gst_net_client_clock_new ("sync-server-clock", clock_addr,
+          gst_sync_server_info_get_clock_port (self->info), 0);
+      break;
+
+    case GST_SYNC_SERVER_CLOCK_TYPE_NTP:
+      clock = gst_ntp_clock_new ("sync-server-clock", clock_addr,
+          gst_sync_server_info_get_clock_port (self->info), 0);
+      break;
+
+    case GST_SYNC_SERVER_CLOCK_TYPE_PTP:
+      if (!gst_ptp_init (GST_PTP_CLOCK_ID_NONE, NULL)) {
+        GST_ERROR_OBJECT (self, "Could not initialise PTP");
+        break;
+      }
+
+      clock = gst_ptp_clock_new ("sync-server-clock",
+          gst_sync_server_info_get_ptp_domain (self->info));
+      break;
+
+    default:
+      GST_ERROR_OBJECT (self, "Unknown clock type %d",
+          gst_sync_server_info_get_clock_type (self->info));
+      break;
+  }
+
+  g_free (clock_addr);
+
+  return clock;
+}
+
 static void
 update_sync_info (GstSyncClient * self, GstSyncServerInfo * info)
 {
@@ -539,19 +1896,46 @@ update_sync_info (GstSyncClient * self, GstSyncServerInfo * info)
   if (!self->info) {
     /* First sync info update */
     GstBus *bus;
-    gchar *clock_addr;
 
     self->info = info;
 
-    clock_addr = gst_sync_server_info_get_clock_address (self->info);
-    self->clock = gst_net_client_clock_new ("sync-server-clock",
-        clock_addr, gst_sync_server_info_get_clock_port (self->info), 0);
-    g_free (clock_addr);
+    self->clock = make_clock (self);
+    if (!self->clock) {
+      GST_ERROR_OBJECT (self, "Could not create clock");
+
+      /* Try again with the next update */
+      g_object_unref (self->info);
+      self->info = NULL;
+
+      g_mutex_unlock (&self->info_lock);
+      return;
+    }
+
+    if (self->calibration_file) {
+      gchar *clock_addr;
+
+      clock_addr = gst_sync_server_info_get_clock_address (self->info);
+      self->calibration_key = g_strdup_printf ("%s:%u", clock_addr,
+          gst_sync_server_info_get_clock_port (self->info));
+      g_free (clock_addr);
 
-    gst_pipeline_use_clock (self->pipeline, self->clock);
+      self->local_clock = make_local_clock ();
+      self->seeded = seed_clock (self);
+    }
+
+    gst_pipeline_use_clock (self->pipeline, get_playback_clock (self));
 
     bus = gst_pipeline_get_bus (self->pipeline);
-    g_object_set (self->clock, "bus", bus, NULL);
+
+    if (GST_IS_NET_CLIENT_CLOCK (self->clock)) {
+      /* Statistics, including when we are synchronised, go on the bus */
+      g_object_set (self->clock, "bus", bus, NULL);
+    } else {
+      g_signal_connect (self->clock, "synced", G_CALLBACK (clock_synced_cb),
+          self);
+      if (gst_clock_is_synced (self->clock))
+        post_clock_synced (self);
+    }
 
     gst_bus_add_watch (bus, bus_cb, self);
     /* See bus_cb() for why we do this */
@@ -560,6 +1944,24 @@ update_sync_info (GstSyncClient * self, GstSyncServerInfo * info)
         G_CALLBACK (bus_cb), self);
 
     gst_object_unref (bus);
+
+    if (self->position_check_interval > 0) {
+      self->position_check_id = g_timeout_add (self->position_check_interval,
+          check_position, self);
+    }
+
+    self->sync_start = g_get_monotonic_time ();
+
+    if (self->seeded) {
+      /* We can start right away, and refine the clock as we go */
+      self->clock_ready = TRUE;
+      update_pipeline (self, FALSE);
+    } else if (self->fast_start) {
+      /* Get decoding and prerolling out of the way while the clock
+       * converges */
+      start_fast_polling (self);
+      update_pipeline (self, FALSE);
+    }
   } else {
     /* Sync info changed, figure out what did. We do not expect the clock
      * parameters or latency to change */
@@ -592,24 +1994,42 @@ update_sync_info (GstSyncClient * self, GstSyncServerInfo * info)
       update_pipeline (self, FALSE);
 
     } else if (old_track != new_track) {
+      gboolean gapless_pending;
+
       GST_INFO_OBJECT (self, "Info change: track# %lu -> %lu", old_track,
           new_track);
 
-      gst_element_set_state (GST_ELEMENT (self->pipeline), GST_STATE_NULL);
-      update_pipeline (self, FALSE);
+      g_mutex_lock (&self->join_lock);
+      gapless_pending = self->gapless_pending;
+      g_mutex_unlock (&self->join_lock);
+
+      if (gapless_pending && new_track == old_track + 1 &&
+          gst_sync_server_info_get_base_time (old_info) ==
+          gst_sync_server_info_get_base_time (self->info)) {
+        /* We already have the next track queued up, and will move along
+         * when it starts (see advance_gapless()). Until then, we're still
+         * on the old one. */
+        g_object_set (self->info,
+            "playlist", gst_sync_server_playlist_set_current_track (
+              gst_sync_server_info_get_playlist (self->info), old_track),
+            "base-time-offset",
+            gst_sync_server_info_get_base_time_offset (old_info),
+            NULL);
+      } else {
+        gst_element_set_state (GST_ELEMENT (self->pipeline), GST_STATE_NULL);
+        update_pipeline (self, FALSE);
+      }
 
     } else if (gst_sync_server_info_get_paused (old_info) !=
         gst_sync_server_info_get_paused (self->info)) {
       GST_INFO_OBJECT (self, "Info change: %spaused",
           gst_sync_server_info_get_paused (self->info) ? "" : "un");
 
-      if (!gst_sync_server_info_get_paused (self->info))
-        set_base_time (self);
-
-      gst_element_set_state (GST_ELEMENT (self->pipeline),
-          gst_sync_server_info_get_paused (self->info) ?
-            GST_STATE_PAUSED :
-            GST_STATE_PLAYING);
+      if (gst_sync_server_info_get_paused (self->info)) {
+        gst_element_set_state (GST_ELEMENT (self->pipeline),
+            GST_STATE_PAUSED);
+      } else if (self->clock_ready)
+        start_playback (self);
 
     } else if (gst_sync_server_info_get_base_time (old_info) !=
         gst_sync_server_info_get_base_time (self->info)) {
@@ -621,6 +2041,9 @@ update_sync_info (GstSyncClient * self, GstSyncServerInfo * info)
       update_pipeline (self, FALSE);
     }
 
+    /* The playlist or the gap between tracks might have changed */
+    update_next_track (self);
+
     g_object_unref (old_info);
   }
 
@@ -670,6 +2093,57 @@ gst_sync_client_set_property (GObject * object, guint property_id,
       self->control_port = g_value_get_int (value);
       break;
 
+    case PROP_STATS_INTERVAL:
+      self->stats_interval = g_value_get_uint (value);
+      break;
+
+    case PROP_FAST_START:
+      self->fast_start = g_value_get_boolean (value);
+      break;
+
+    case PROP_SYNC_ERROR_BOUND:
+      self->sync_error_bound = g_value_get_uint64 (value);
+      break;
+
+    case PROP_CALIBRATION_FILE:
+      g_free (self->calibration_file);
+      self->calibration_file = g_value_dup_string (value);
+      break;
+
+    case PROP_ADAPTIVE_POLL:
+      self->adaptive_poll = g_value_get_boolean (value);
+      break;
+
+    case PROP_POSITION_CHECK_INTERVAL:
+      self->position_check_interval = g_value_get_uint (value);
+      break;
+
+    case PROP_AUDIO_SERVO:
+      self->use_audio_servo = g_value_get_boolean (value);
+      break;
+
+    case PROP_SEEK_FLAGS:
+      self->seek_flags = g_value_get_flags (value);
+      break;
+
+    case PROP_SEEK_TOLERANCE:
+      self->seek_tolerance = g_value_get_uint64 (value);
+      break;
+
+    case PROP_AUDIO_SERVO_PROPORTIONAL_GAIN:
+      g_object_set_property (G_OBJECT (self->audio_servo),
+          "proportional-gain", value);
+      break;
+
+    case PROP_AUDIO_SERVO_INTEGRAL_GAIN:
+      g_object_set_property (G_OBJECT (self->audio_servo), "integral-gain",
+          value);
+      break;
+
+    case PROP_AUDIO_SERVO_MAX_STEP:
+      g_object_set_property (G_OBJECT (self->audio_servo), "max-step", value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -707,6 +2181,72 @@ gst_sync_client_get_property (GObject * object, guint property_id,
       g_value_set_object (value, self->pipeline);
       break;
 
+    case PROP_CLOCK_STATS:
+      g_mutex_lock (&self->stats_lock);
+      g_value_set_variant (value, self->clock_stats);
+      g_mutex_unlock (&self->stats_lock);
+      break;
+
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint (value, self->stats_interval);
+      break;
+
+    case PROP_FAST_START:
+      g_value_set_boolean (value, self->fast_start);
+      break;
+
+    case PROP_SYNC_ERROR_BOUND:
+      g_value_set_uint64 (value, self->sync_error_bound);
+      break;
+
+    case PROP_CALIBRATION_FILE:
+      g_value_set_string (value, self->calibration_file);
+      break;
+
+    case PROP_STARTUP_TIME:
+      g_value_set_uint64 (value, self->startup_time);
+      break;
+
+    case PROP_ADAPTIVE_POLL:
+      g_value_set_boolean (value, self->adaptive_poll);
+      break;
+
+    case PROP_POSITION_CHECK_INTERVAL:
+      g_value_set_uint (value, self->position_check_interval);
+      break;
+
+    case PROP_POSITION_STATS:
+      g_mutex_lock (&self->stats_lock);
+      g_value_take_variant (value, get_position_stats (self));
+      g_mutex_unlock (&self->stats_lock);
+      break;
+
+    case PROP_AUDIO_SERVO:
+      g_value_set_boolean (value, self->use_audio_servo);
+      break;
+
+    case PROP_AUDIO_SERVO_PROPORTIONAL_GAIN:
+      g_object_get_property (G_OBJECT (self->audio_servo),
+          "proportional-gain", value);
+      break;
+
+    case PROP_AUDIO_SERVO_INTEGRAL_GAIN:
+      g_object_get_property (G_OBJECT (self->audio_servo), "integral-gain",
+          value);
+      break;
+
+    case PROP_AUDIO_SERVO_MAX_STEP:
+      g_object_get_property (G_OBJECT (self->audio_servo), "max-step", value);
+      break;
+
+    case PROP_SEEK_FLAGS:
+      g_value_set_flags (value, self->seek_flags);
+      break;
+
+    case PROP_SEEK_TOLERANCE:
+      g_value_set_uint64 (value, self->seek_tolerance);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -796,6 +2336,259 @@ gst_sync_client_class_init (GstSyncClientClass * klass)
         GST_TYPE_PIPELINE,
         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstSyncClient:clock-stats:
+   *
+   * The most recent statistics for synchronisation with the server's clock,
+   * as a dictionary with the following keys:
+   *
+   *   * "synchronised" (boolean): whether the clock is currently synchronised
+   *   * "rtt" (uint64): rolling average round trip time in nanoseconds
+   *   * "offset" (int64): offset of the local clock from the server clock in
+   *     nanoseconds
+   *   * "rate" (double): rate of the local clock relative to the server clock
+   *   * "r-squared" (double): quality of the clock regression
+   *
+   * NULL until the first statistics are received. These are only available
+   * with the network and NTP clocks, PTP does not provide statistics.
+   */
+  g_object_class_install_property (object_class, PROP_CLOCK_STATS,
+      g_param_spec_variant ("clock-stats", "Clock statistics",
+        "Statistics for synchronisation with the server clock",
+        G_VARIANT_TYPE_VARDICT, NULL,
+        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:stats-interval:
+   *
+   * How often, in milliseconds, clock statistics are reported to the server.
+   * Changes in synchronisation state are always reported immediately. Set to
+   * 0 to disable reporting.
+   */
+  g_object_class_install_property (object_class, PROP_STATS_INTERVAL,
+      g_param_spec_uint ("stats-interval", "Stats interval",
+        "Interval for reporting clock statistics to the server in ms "
+        "(0 = disabled)", 0, G_MAXUINT, DEFAULT_STATS_INTERVAL,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:fast-start:
+   *
+   * By default, the client waits for its clock to synchronise with the server
+   * before it starts preparing the stream. If this is set, the stream is
+   * prerolled while the clock synchronises, and the clock is polled rapidly
+   * until it is within #GstSyncClient:sync-error-bound of the server's, which
+   * reduces the time to start playback. Must be set before the client is
+   * started.
+   */
+  g_object_class_install_property (object_class, PROP_FAST_START,
+      g_param_spec_boolean ("fast-start", "Fast start",
+        "Preroll while the clock synchronises", DEFAULT_FAST_START,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:sync-error-bound:
+   *
+   * With #GstSyncClient:fast-start, how close (in nanoseconds) the clock must
+   * be estimated to be to the server's before playback starts. The estimate
+   * is based on the round trip time to the server, so this is not used with
+   * PTP. If the clock does not get this close within a few seconds, playback
+   * is started anyway.
+   */
+  g_object_class_install_property (object_class, PROP_SYNC_ERROR_BOUND,
+      g_param_spec_uint64 ("sync-error-bound", "Sync error bound",
+        "Maximum estimated clock error to start playback with in fast start "
+        "mode (ns)", 0, G_MAXUINT64, DEFAULT_SYNC_ERROR_BOUND,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:calibration-file:
+   *
+   * If set, the client periodically saves how its clock relates to the
+   * server's clock to this file, and uses that on the next start to begin
+   * playback without waiting for the clock to synchronise. The estimate is
+   * then refined as the clock synchronises. Calibrations are kept per clock
+   * address and port, and are only used if they are recent and the system
+   * has not been rebooted since. Must be set before the client is started.
+   */
+  g_object_class_install_property (object_class, PROP_CALIBRATION_FILE,
+      g_param_spec_string ("calibration-file", "Calibration file",
+        "File to save clock calibration to, and start from (NULL = disabled)",
+        NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:startup-time:
+   *
+   * How long it took from the client being started to synchronised playback
+   * starting, in nanoseconds, or #GST_CLOCK_TIME_NONE if playback has not yet
+   * started.
+   */
+  g_object_class_install_property (object_class, PROP_STARTUP_TIME,
+      g_param_spec_uint64 ("startup-time", "Startup time",
+        "Time taken to start synchronised playback (ns)", 0, G_MAXUINT64,
+        GST_CLOCK_TIME_NONE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:adaptive-poll:
+   *
+   * Whether to adapt how often the network clock is polled to how stable it
+   * is. The clock is polled often while the round trip time to the server
+   * varies or the clock is still being corrected, and progressively less
+   * often (up to every few seconds) once it is stable. Unless the server
+   * advertises a #GstSyncServer:clock-poll-budget, "often" is the clock's
+   * own default poll interval, so this never adds load on the time provider.
+   * This only applies to the default network clock type.
+   */
+  g_object_class_install_property (object_class, PROP_ADAPTIVE_POLL,
+      g_param_spec_boolean ("adaptive-poll", "Adaptive poll",
+        "Adapt the clock poll interval to the clock's stability",
+        DEFAULT_ADAPTIVE_POLL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:position-check-interval:
+   *
+   * How often (in milliseconds) to check that the playback position matches
+   * the server's timeline. Small errors are corrected by adjusting the
+   * pipeline's base time, which makes the sinks drop or insert a little
+   * data, and errors larger than #GstSyncClient:seek-tolerance with a seek.
+   * Set to 0 to disable. Must be set before the client is started.
+   */
+  g_object_class_install_property (object_class,
+      PROP_POSITION_CHECK_INTERVAL,
+      g_param_spec_uint ("position-check-interval", "Position check interval",
+        "Interval between playback position checks (ms, 0 = disabled)", 0,
+        G_MAXUINT, DEFAULT_POSITION_CHECK_INTERVAL,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:position-stats:
+   *
+   * A dictionary (a{sv}) describing how well playback is following the
+   * server's timeline: "error" (x) is the smoothed position error in
+   * nanoseconds, positive if we are ahead, and "nudges" (t) and "seeks" (t)
+   * count the base time adjustments and seeks made to correct it. These are
+   * also included in the statistics reported to the server.
+   */
+  g_object_class_install_property (object_class, PROP_POSITION_STATS,
+      g_param_spec_variant ("position-stats", "Position statistics",
+        "Playback position error statistics", G_VARIANT_TYPE_VARDICT, NULL,
+        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:audio-servo:
+   *
+   * By default, the audio sink lets its device clock drift up to 10 ms from
+   * the network clock and then jumps back, which is audible, and is a lot for
+   * speakers in the same room. If this is set, a control loop instead adjusts
+   * the audio continuously by tiny amounts, keeping it within a fraction of
+   * a millisecond of the network clock. The loop can be tuned with the
+   * audio-servo-* properties. When enabled, the current error is also
+   * included in #GstSyncClient:position-stats as "audio-error". Must be set
+   * before the client is started.
+   */
+  g_object_class_install_property (object_class, PROP_AUDIO_SERVO,
+      g_param_spec_boolean ("audio-servo", "Audio servo",
+        "Continuously adjust audio to track the network clock",
+        DEFAULT_AUDIO_SERVO, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:audio-servo-proportional-gain:
+   *
+   * With #GstSyncClient:audio-servo, the fraction of the current error that
+   * is corrected every time the sink renders. Higher values converge faster,
+   * but follow network clock jitter more closely.
+   */
+  g_object_class_install_property (object_class,
+      PROP_AUDIO_SERVO_PROPORTIONAL_GAIN,
+      g_param_spec_double ("audio-servo-proportional-gain",
+        "Audio servo proportional gain",
+        "Fraction of the audio clock error to correct on each update",
+        0.0, 1.0, GST_SYNC_AUDIO_SERVO_DEFAULT_PROPORTIONAL_GAIN,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:audio-servo-integral-gain:
+   *
+   * With #GstSyncClient:audio-servo, the fraction of the accumulated error
+   * that is corrected every time the sink renders. This is what makes up for
+   * the audio device running at a slightly different rate from the network
+   * clock. Too high a value causes the error to oscillate.
+   */
+  g_object_class_install_property (object_class,
+      PROP_AUDIO_SERVO_INTEGRAL_GAIN,
+      g_param_spec_double ("audio-servo-integral-gain",
+        "Audio servo integral gain",
+        "Fraction of the accumulated audio clock error to correct on each "
+        "update", 0.0, 1.0, GST_SYNC_AUDIO_SERVO_DEFAULT_INTEGRAL_GAIN,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:audio-servo-max-step:
+   *
+   * With #GstSyncClient:audio-servo, the largest correction (in nanoseconds)
+   * to make at a time. The default is a couple of samples at common rates,
+   * which is inaudible.
+   */
+  g_object_class_install_property (object_class, PROP_AUDIO_SERVO_MAX_STEP,
+      g_param_spec_uint64 ("audio-servo-max-step", "Audio servo maximum step",
+        "Largest audio correction to make at a time (ns)", 0, G_MAXUINT64,
+        GST_SYNC_AUDIO_SERVO_DEFAULT_MAX_STEP,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:seek-flags:
+   *
+   * Flags for seeks to the server's timeline, when joining and when
+   * correcting large position errors. The seek is always flushing. The
+   * default seeks to the next keyframe, which is quick. Use
+   * %GST_SEEK_FLAG_ACCURATE to land exactly where we need to be, at the cost
+   * of decoding from the previous keyframe.
+   */
+  g_object_class_install_property (object_class, PROP_SEEK_FLAGS,
+      g_param_spec_flags ("seek-flags", "Seek flags",
+        "Flags for seeks to the timeline position", GST_TYPE_SEEK_FLAGS,
+        DEFAULT_SEEK_FLAGS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient:seek-tolerance:
+   *
+   * How far (in nanoseconds) playback must be from the server's timeline
+   * before we seek rather than clip or wait. Seeks are aimed ahead by how
+   * long seeking has taken before, so that we land where the timeline will
+   * be when the seek completes.
+   */
+  g_object_class_install_property (object_class, PROP_SEEK_TOLERANCE,
+      g_param_spec_uint64 ("seek-tolerance", "Seek tolerance",
+        "Position error past which to seek (ns)", 0, G_MAXUINT64,
+        DEFAULT_SEEK_TOLERANCE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncClient::clock-stats:
+   * @client: the #GstSyncClient
+   * @stats: (transfer none): the clock statistics as a #GVariant dictionary
+   *
+   * Emitted whenever new clock statistics are available. See
+   * #GstSyncClient:clock-stats for the contents of @stats.
+   */
+  g_signal_new_class_handler ("clock-stats", GST_TYPE_SYNC_CLIENT,
+      G_SIGNAL_RUN_LAST, NULL, NULL, NULL, NULL, G_TYPE_NONE, 1,
+      G_TYPE_VARIANT, NULL);
+
+  /**
+   * GstSyncClient::join-completed:
+   * @client: the #GstSyncClient
+   * @stats: (transfer none): a #GVariant dictionary describing the join
+   *
+   * Emitted when we have started playing a track in sync, whether on
+   * joining or moving to the next track. @stats contains "error" (x), how
+   * far ahead of the timeline we started in nanoseconds (negative means the
+   * start was clipped), "time" (t), how long it took from loading the track,
+   * and "seek-time" (t), how long the seek took (0 if we did not seek).
+   */
+  g_signal_new_class_handler ("join-completed", GST_TYPE_SYNC_CLIENT,
+      G_SIGNAL_RUN_LAST, NULL, NULL, NULL, NULL, G_TYPE_NONE, 1,
+      G_TYPE_VARIANT, NULL);
+
   GST_DEBUG_CATEGORY_INIT (sync_client_debug, "syncclient", 0, "GstSyncClient");
 }
 
@@ -843,14 +2636,94 @@ gst_sync_client_init (GstSyncClient * self)
   self->info = NULL;
   g_mutex_init (&self->info_lock);
 
+  g_mutex_init (&self->join_lock);
+  self->can_join_seek = FALSE;
+  self->join_pending = FALSE;
+  self->join_blocked = FALSE;
+  self->join_block_time = 0;
+  self->join_probes = NULL;
+
+  self->seek_flags = DEFAULT_SEEK_FLAGS;
+  self->seek_tolerance = DEFAULT_SEEK_TOLERANCE;
+  self->current_uri = NULL;
+  self->seek_times = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      g_free);
+  self->last_seek_time = 0;
+  self->seek_uri = NULL;
+  self->seek_start = 0;
+  self->joining = FALSE;
+  self->join_start = 0;
+  self->join_result = NULL;
+
+  self->next_uri = NULL;
+  self->gapless_pending = FALSE;
+
   self->pipeline = GST_PIPELINE (gst_element_factory_make ("playbin", NULL));
   if (!self->pipeline)
     GST_ERROR_OBJECT (self, "Could not instantiate playbin");
+  else {
+    GstElement *playsink;
+
+    /* This is where decoded streams come in, see start_join() */
+    playsink = gst_bin_get_by_name (GST_BIN (self->pipeline), "playsink");
+    if (playsink) {
+      g_signal_connect (playsink, "pad-added",
+          G_CALLBACK (playsink_pad_added_cb), self);
+      self->can_join_seek = TRUE;
+      gst_object_unref (playsink);
+    } else
+      GST_WARNING_OBJECT (self, "No playsink, will seek after prerolling");
+
+    g_signal_connect (self->pipeline, "about-to-finish",
+        G_CALLBACK (about_to_finish_cb), self);
+  }
 
   self->synchronised = FALSE;
 
+  self->fast_start = DEFAULT_FAST_START;
+  self->sync_error_bound = DEFAULT_SYNC_ERROR_BOUND;
+  self->clock_ready = FALSE;
+  self->sync_start = 0;
+  self->fast_polling = FALSE;
+
+  self->adaptive_poll = DEFAULT_ADAPTIVE_POLL;
+  self->poll_interval = GST_CLOCK_TIME_NONE;
+  self->rtt_avg = 0;
+  self->rtt_dev = 0;
+  self->stable_polls = 0;
+
+  self->calibration_file = NULL;
+  self->calibration_key = NULL;
+  self->local_clock = NULL;
+  self->seeded = FALSE;
+  self->last_calibration_save = 0;
+
+  self->start_time = 0;
+  self->startup_time = GST_CLOCK_TIME_NONE;
+
+  self->clock_stats = NULL;
+  g_mutex_init (&self->stats_lock);
+  self->stats_interval = DEFAULT_STATS_INTERVAL;
+  self->last_stats_report = 0;
+  self->last_stats_synchronised = FALSE;
+
+  self->preroll_start = 0;
+  self->measured_latency = GST_CLOCK_TIME_NONE;
+
+  self->use_audio_servo = DEFAULT_AUDIO_SERVO;
+  self->audio_servo = gst_sync_audio_servo_new ();
+
   self->seek_offset = 0;
   g_atomic_int_set (&self->seek_state, NEED_SEEK);
+  self->is_live = FALSE;
+
+  self->position_check_interval = DEFAULT_POSITION_CHECK_INTERVAL;
+  self->position_check_id = 0;
+  self->position_correction = 0;
+  self->position_error = 0;
+  self->have_position_error = FALSE;
+  self->position_nudges = 0;
+  self->position_seeks = 0;
 }
 
 /**
@@ -896,6 +2769,8 @@ gst_sync_client_start (GstSyncClient * client, GError ** err)
   gboolean ret;
   gchar *id;
 
+  client->start_time = g_get_monotonic_time ();
+
   if (!client->client) {
     GstSyncControlTcpClient *tcp_client;
 
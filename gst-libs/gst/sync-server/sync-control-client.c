@@ -46,6 +46,9 @@
  *     that are used to have the client connect to and disconnect from the
  *     server.
  *
+ *   * The optional GstSyncControlClient::report-stats signal, used to send
+ *     the client's clock statistics to the server.
+ *
  * The specifics of how the connection  to the server is established, and how
  * data is received is entirely up to the implementation. It is expected that
  * the server will use a corresponding #GstSyncControlServer implementation.
@@ -133,6 +136,19 @@ gst_sync_control_client_default_init (GstSyncControlClientInterface * iface)
   g_signal_new_class_handler ("stop", GST_TYPE_SYNC_CONTROL_CLIENT,
       G_SIGNAL_ACTION | G_SIGNAL_RUN_LAST, NULL, NULL, NULL, NULL, G_TYPE_NONE,
       0, NULL);
+
+  /**
+   * GstSyncControlClient::report-stats:
+   * @client: the #GstSyncControlClient
+   * @stats: (transfer none): clock statistics as a #GVariant dictionary
+   *
+   * Send the client's clock statistics to the server, which emits them in
+   * #GstSyncControlServer::client-stats. Implementations that do not support
+   * this can just not handle the signal.
+   */
+  g_signal_new_class_handler ("report-stats", GST_TYPE_SYNC_CONTROL_CLIENT,
+      G_SIGNAL_ACTION | G_SIGNAL_RUN_LAST, NULL, NULL, NULL, NULL, G_TYPE_NONE,
+      1, G_TYPE_VARIANT, NULL);
 }
 
 /**
@@ -223,6 +239,20 @@ gst_sync_control_client_stop (GstSyncControlClient * client)
   g_signal_emit_by_name (client, "stop");
 }
 
+/**
+ * gst_sync_control_client_report_stats
+ * @client: The #GstSyncControlClient
+ * @stats: (transfer none): Clock statistics as a #GVariant dictionary
+ *
+ * Sends clock statistics to the server, if @client supports it.
+ */
+void
+gst_sync_control_client_report_stats (GstSyncControlClient * client,
+    GVariant * stats)
+{
+  g_signal_emit_by_name (client, "report-stats", stats);
+}
+
 /**
  * gst_sync_control_client_get_sync_info
  * @client: The #GstSyncControlClient
@@ -44,6 +44,9 @@ gboolean gst_sync_control_client_start (GstSyncControlClient * client,
     GError ** error);
 void gst_sync_control_client_stop (GstSyncControlClient * client);
 
+void gst_sync_control_client_report_stats (GstSyncControlClient * client,
+    GVariant * stats);
+
 GstSyncServerInfo *
 gst_sync_control_client_get_sync_info (GstSyncControlClient * client);
 
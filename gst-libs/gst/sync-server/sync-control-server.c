@@ -46,6 +46,9 @@
  *     server knows when a client joins (and any associated configuration
  *     information, if present).
  *
+ *   * The optional GstSyncControlServer::client-stats signal, emitted when a
+ *     client reports its clock statistics.
+ *
  * The specifics of how connections from clients are received, and how data is
  * sent is entirely up to the implementation. It is expected that clients will
  * use a corresponding #GstSyncControlClient implementation.
@@ -133,6 +136,21 @@ gst_sync_control_server_default_init (GstSyncControlServerInterface * iface)
   g_signal_new_class_handler ("client-left", GST_TYPE_SYNC_CONTROL_SERVER,
       G_SIGNAL_RUN_LAST, NULL, NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_STRING,
       NULL);
+
+  /**
+   * GstSyncControlServer::client-stats:
+   * @server: the #GstSyncControlServer
+   * @id: (transfer none): the client ID as a string
+   * @stats: (transfer none): the client's clock statistics as a #GVariant
+   *         dictionary
+   *
+   * Emitted whenever a client reports its clock statistics (see
+   * #GstSyncControlClient::report-stats). This might be emitted from any
+   * thread.
+   */
+  g_signal_new_class_handler ("client-stats", GST_TYPE_SYNC_CONTROL_SERVER,
+      G_SIGNAL_RUN_LAST, NULL, NULL, NULL, NULL, G_TYPE_NONE, 2, G_TYPE_STRING,
+      G_TYPE_VARIANT, NULL);
 }
 
 /**
@@ -22,12 +22,12 @@
 
 #include <glib-object.h>
 #include <gio/gio.h>
-#include <json-glib/json-glib.h>
 
 #include "sync-server.h"
 #include "sync-client.h"
 #include "sync-control-client.h"
 #include "sync-control-tcp-client.h"
+#include "sync-control-tcp-protocol.h"
 
 struct _GstSyncControlTcpClient {
   GObject parent;
@@ -38,8 +38,16 @@ struct _GstSyncControlTcpClient {
   gchar *addr;
   gint port;
   GstSyncServerInfo *info;
+  guint64 revision;
+  gboolean resync_pending;
 
   GSocketConnection *conn;
+  /* Cancelled when we stop, so that reads and writes still in flight for
+   * the old connection know to leave us alone */
+  GCancellable *cancellable;
+  /* Messages waiting to be written, the head is being written out */
+  GQueue out;
+  GByteArray *in;
   gchar buf[4096];
 };
 
@@ -47,6 +55,14 @@ struct _GstSyncControlTcpClientClass {
   GObjectClass parent;
 };
 
+/* What an asynchronous read or write needs to hold on to until it is done */
+typedef struct {
+  GstSyncControlTcpClient *self;
+  GCancellable *cancellable;
+  /* The message being written, NULL for reads */
+  GBytes *msg;
+} Pending;
+
 #define gst_sync_control_tcp_client_parent_class parent_class
 G_DEFINE_TYPE_WITH_CODE (GstSyncControlTcpClient, gst_sync_control_tcp_client,
     G_TYPE_OBJECT, G_IMPLEMENT_INTERFACE (GST_TYPE_SYNC_CONTROL_CLIENT, NULL));
@@ -166,111 +182,259 @@ gst_sync_control_tcp_client_dispose (GObject * object)
     self->info = NULL;
   }
 
+  if (self->in) {
+    g_byte_array_unref (self->in);
+    self->in = NULL;
+  }
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
-static gchar *
-make_client_info (gchar * id, GVariant * config)
+static Pending *
+pending_new (GstSyncControlTcpClient * self, GBytes * msg)
+{
+  Pending *pending = g_new0 (Pending, 1);
+
+  pending->self = g_object_ref (self);
+  pending->cancellable = g_object_ref (self->cancellable);
+  pending->msg = msg ? g_bytes_ref (msg) : NULL;
+
+  return pending;
+}
+
+static void
+pending_free (Pending * pending)
+{
+  g_object_unref (pending->self);
+  g_object_unref (pending->cancellable);
+  if (pending->msg)
+    g_bytes_unref (pending->msg);
+  g_free (pending);
+}
+
+static void write_next (GstSyncControlTcpClient * self);
+
+static void
+send_done_cb (GObject * object, GAsyncResult * res, gpointer user_data)
 {
-  JsonBuilder *builder;
-  JsonNode *node;
-  gboolean free_config = FALSE;
-  gchar *ret;
-
-  if (!config) {
-    free_config = TRUE;
-    config = g_variant_new ("a{sv}", NULL);
+  Pending *pending = (Pending *) user_data;
+  GstSyncControlTcpClient *self = pending->self;
+  GOutputStream *ostream = (GOutputStream *) object;
+  GBytes *msg;
+  gsize len;
+  GError *err = NULL;
+  gboolean ret;
+
+  ret = g_output_stream_write_all_finish (ostream, res, &len, &err);
+
+  /* We were stopped meanwhile, and the queue is not ours any more */
+  if (g_cancellable_is_cancelled (pending->cancellable)) {
+    g_clear_error (&err);
+    goto done;
+  }
+
+  if (!ret) {
+    g_warning ("Could not send message: %s", err->message);
+    g_error_free (err);
+
+    /* Nothing behind this can go out either, so give up on the connection
+     * rather than queueing messages forever */
+    gst_sync_control_tcp_client_stop (self);
+    goto done;
   }
 
-  builder = json_builder_new ();
+  msg = g_queue_pop_head (&self->out);
+  g_bytes_unref (msg);
+
+  if (!g_queue_is_empty (&self->out))
+    write_next (self);
+
+done:
+  pending_free (pending);
+}
+
+static void
+write_next (GstSyncControlTcpClient * self)
+{
+  GOutputStream *ostream;
+  GBytes *msg;
+  gconstpointer data;
+  gsize len;
 
-  json_builder_begin_object (builder);
+  ostream = g_io_stream_get_output_stream (G_IO_STREAM (self->conn));
+  msg = g_queue_peek_head (&self->out);
+  data = g_bytes_get_data (msg, &len);
 
-  json_builder_set_member_name (builder, "id");
-  json_builder_add_string_value (builder, id);
+  /* msg stays in the queue until the write is done, and we hold a reference
+   * of our own in case the queue is flushed before that */
+  g_output_stream_write_all_async (ostream, data, len, 0, self->cancellable,
+      send_done_cb, pending_new (self, msg));
+}
 
-  json_builder_set_member_name (builder, "config");
-  json_builder_add_value (builder, json_gvariant_serialize (config));
+/* Takes ownership of msg */
+static void
+send_message (GstSyncControlTcpClient * self, GBytes * msg)
+{
+  g_queue_push_tail (&self->out, msg);
 
-  json_builder_end_object (builder);
+  /* Only one write can be pending at a time */
+  if (g_queue_get_length (&self->out) == 1)
+    write_next (self);
+}
 
-  node = json_builder_get_root (builder);
+static void
+send_client_info (GstSyncControlTcpClient * self)
+{
+  gchar *info;
 
-  ret = json_to_string (node, FALSE);
+  info = gst_sync_control_tcp_client_info_new (self->id, self->config);
+  send_message (self, gst_sync_control_tcp_message_new
+      (GST_SYNC_CONTROL_TCP_MESSAGE_CLIENT_INFO, info, strlen (info)));
+  g_free (info);
+}
 
-  json_builder_reset (builder);
-  json_node_free (node);
+static void
+set_sync_info (GstSyncControlTcpClient * self, GstSyncServerInfo * info,
+    guint64 revision)
+{
+  if (self->info)
+    g_object_unref (self->info);
+  self->info = info;
+  self->revision = revision;
 
-  if (free_config)
-    g_variant_unref (config);
+  /* Let the server know it can send us deltas against this revision */
+  send_message (self, gst_sync_control_tcp_message_new_with_revisions
+      (GST_SYNC_CONTROL_TCP_MESSAGE_ACK, &revision, 1, NULL));
 
-  return ret;
+  g_object_notify (G_OBJECT (self), "sync-info");
 }
 
 static void
-send_done_cb (GObject * object, GAsyncResult * res, gpointer user_data)
+handle_sync_info (GstSyncControlTcpClient * self, GBytes * payload)
 {
-  GstSyncControlTcpClient * self = GST_SYNC_CONTROL_TCP_CLIENT (user_data);
-  GOutputStream *ostream = (GOutputStream *) object;
-  gssize len;
+  GstSyncServerInfo *info;
+  GBytes *data;
+  guint64 revision;
   GError *err = NULL;
 
-  if (!g_output_stream_write_all_finish (ostream, res, &len, &err)) {
-    if (err) {
-      g_warning ("Could not send client info: %s", err->message);
-      g_error_free (err);
-    }
+  if (!gst_sync_control_tcp_payload_get_revisions (payload, &revision, 1,
+        &data)) {
+    g_warning ("Got truncated sync info");
+    return;
+  }
+
+  info = gst_sync_server_info_from_bytes (data, &err);
+  g_bytes_unref (data);
 
+  if (!info) {
+    g_warning ("Could not parse sync info: %s", err->message);
+    g_error_free (err);
     return;
   }
 
-  /* Now that we've sent client info, we can wait for sync info */
-  read_sync_info (self);
+  self->resync_pending = FALSE;
+  set_sync_info (self, info, revision);
 }
 
 static void
-send_client_info (GstSyncControlTcpClient * self)
+handle_sync_info_delta (GstSyncControlTcpClient * self, GBytes * payload)
 {
-  gchar *info;
-  GOutputStream *ostream;
+  GstSyncServerInfo *info;
+  GBytes *data;
+  guint64 revisions[2];
+  GError *err = NULL;
 
-  info = make_client_info (self->id, self->config);
-  ostream = g_io_stream_get_output_stream (G_IO_STREAM (self->conn));
+  /* Everything until the snapshot we asked for is useless */
+  if (self->resync_pending)
+    return;
+
+  if (!gst_sync_control_tcp_payload_get_revisions (payload, revisions, 2,
+        &data)) {
+    g_warning ("Got truncated sync info delta");
+    return;
+  }
 
-  g_output_stream_write_all_async (ostream, info, strlen (info), 0, NULL,
-      send_done_cb, self);
+  info = NULL;
+  if (self->info && revisions[0] == self->revision) {
+    info = gst_sync_server_info_patch (self->info, data, &err);
+
+    if (!info) {
+      g_warning ("Could not apply sync info delta: %s", err->message);
+      g_error_free (err);
+    }
+  } else {
+    g_warning ("Got sync info delta against revision %" G_GUINT64_FORMAT
+        ", but we have %" G_GUINT64_FORMAT, revisions[0], self->revision);
+  }
+
+  g_bytes_unref (data);
+
+  if (!info) {
+    self->resync_pending = TRUE;
+    send_message (self, gst_sync_control_tcp_message_new
+        (GST_SYNC_CONTROL_TCP_MESSAGE_RESYNC, NULL, 0));
+    return;
+  }
+
+  set_sync_info (self, info, revisions[1]);
 }
 
 static void
 read_done_cb (GObject * object, GAsyncResult * res, gpointer user_data)
 {
-  GstSyncControlTcpClient * self = GST_SYNC_CONTROL_TCP_CLIENT (user_data);
+  Pending *pending = (Pending *) user_data;
+  GstSyncControlTcpClient *self = pending->self;
   GInputStream *istream = (GInputStream *) object;
   gssize len;
+  guint8 type;
+  GBytes *payload;
   GError *err = NULL;
 
   len = g_input_stream_read_finish (istream, res, &err);
+
+  if (g_cancellable_is_cancelled (pending->cancellable)) {
+    g_clear_error (&err);
+    goto done;
+  }
+
   if (len < 1) {
     if (err) {
       g_warning ("Could not read sync info: %s", err->message);
       g_error_free (err);
     }
-    return;
+    goto done;
   }
 
-  self->info =
-    GST_SYNC_SERVER_INFO (json_gobject_from_data (GST_TYPE_SYNC_SERVER_INFO,
-          self->buf, len, &err));
+  g_byte_array_append (self->in, (guint8 *) self->buf, len);
 
-  if (!self->info) {
-    g_warning ("Could not parse JSON: %s", err->message);
-    g_error_free (err);
-    return;
-  }
+  /* A read may contain several messages, or just a part of one */
+  while (gst_sync_control_tcp_message_pop (self->in, &type, &payload)) {
+    switch (type) {
+      case GST_SYNC_CONTROL_TCP_MESSAGE_SYNC_INFO:
+        handle_sync_info (self, payload);
+        break;
 
-  g_object_notify (G_OBJECT (self), "sync-info");
+      case GST_SYNC_CONTROL_TCP_MESSAGE_SYNC_INFO_DELTA:
+        handle_sync_info_delta (self, payload);
+        break;
+
+      default:
+        g_warning ("Ignoring unexpected message type %u", type);
+        break;
+    }
+
+    g_bytes_unref (payload);
+
+    /* Whoever got notified of the new sync info might have stopped us (and
+     * maybe started again on a new connection, which has its own read) */
+    if (g_cancellable_is_cancelled (pending->cancellable))
+      goto done;
+  }
 
   read_sync_info (self);
+
+done:
+  pending_free (pending);
 }
 
 static void
@@ -280,9 +444,8 @@ read_sync_info (GstSyncControlTcpClient * self)
 
   istream = g_io_stream_get_input_stream (G_IO_STREAM (self->conn));
 
-  memset (self->buf, 0, sizeof (self->buf));
-  g_input_stream_read_async (istream, self->buf, sizeof (self->buf) - 1, 0,
-      NULL, read_done_cb, self);
+  g_input_stream_read_async (istream, self->buf, sizeof (self->buf), 0,
+      self->cancellable, read_done_cb, pending_new (self, NULL));
 }
 
 static gboolean
@@ -302,7 +465,11 @@ gst_sync_control_tcp_client_start (GstSyncControlTcpClient * self,
     goto done;
   }
 
+  self->cancellable = g_cancellable_new ();
+
   send_client_info (self);
+  /* The server will send sync info once it has our info */
+  read_sync_info (self);
 
 done:
   g_object_unref (client);
@@ -312,11 +479,45 @@ done:
 static void
 gst_sync_control_tcp_client_stop (GstSyncControlTcpClient * self)
 {
+  if (self->cancellable) {
+    g_cancellable_cancel (self->cancellable);
+    g_object_unref (self->cancellable);
+    self->cancellable = NULL;
+  }
+
   if (self->conn) {
     g_io_stream_close (G_IO_STREAM (self->conn), NULL, NULL);
     g_object_unref (self->conn);
     self->conn = NULL;
   }
+
+  if (self->in)
+    g_byte_array_set_size (self->in, 0);
+
+  g_queue_foreach (&self->out, (GFunc) g_bytes_unref, NULL);
+  g_queue_clear (&self->out);
+
+  self->resync_pending = FALSE;
+}
+
+static void
+gst_sync_control_tcp_client_report_stats (GstSyncControlTcpClient * self,
+    GVariant * stats)
+{
+  GBytes *payload;
+  gconstpointer data;
+  gsize len;
+
+  if (!self->conn)
+    return;
+
+  payload = gst_sync_control_tcp_client_stats_new (self->id, stats);
+  data = g_bytes_get_data (payload, &len);
+
+  send_message (self, gst_sync_control_tcp_message_new
+      (GST_SYNC_CONTROL_TCP_MESSAGE_CLIENT_STATS, data, len));
+
+  g_bytes_unref (payload);
 }
 
 static void
@@ -338,6 +539,9 @@ gst_sync_control_tcp_client_class_init (GstSyncControlTcpClientClass * klass)
       G_CALLBACK (gst_sync_control_tcp_client_start));
   g_signal_override_class_handler ("stop", GST_TYPE_SYNC_CONTROL_TCP_CLIENT,
       G_CALLBACK (gst_sync_control_tcp_client_stop));
+  g_signal_override_class_handler ("report-stats",
+      GST_TYPE_SYNC_CONTROL_TCP_CLIENT,
+      G_CALLBACK (gst_sync_control_tcp_client_report_stats));
 }
 
 static void
@@ -347,6 +551,10 @@ gst_sync_control_tcp_client_init (GstSyncControlTcpClient *self)
   self->port = 0;
 
   self->info = NULL;
+  self->revision = 0;
+  self->resync_pending = FALSE;
 
   self->conn = NULL;
+  g_queue_init (&self->out);
+  self->in = g_byte_array_new ();
 }
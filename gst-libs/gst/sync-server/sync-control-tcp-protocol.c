@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <json-glib/json-glib.h>
+
+#include "sync-control-tcp-protocol.h"
+
+static GBytes *
+make_message (GstSyncControlTcpMessageType type, const guint64 * revisions,
+    guint n_revisions, gconstpointer data, gsize len)
+{
+  guint8 *msg, *p;
+  guint32 size;
+  gsize payload_len;
+  guint i;
+
+  payload_len = n_revisions * GST_SYNC_CONTROL_TCP_REVISION_SIZE + len;
+  g_return_val_if_fail (payload_len <= G_MAXUINT32, NULL);
+
+  msg = g_malloc (GST_SYNC_CONTROL_TCP_HEADER_SIZE + payload_len);
+
+  size = GUINT32_TO_BE ((guint32) payload_len);
+  memcpy (msg, &size, sizeof (size));
+  msg[4] = type;
+
+  p = msg + GST_SYNC_CONTROL_TCP_HEADER_SIZE;
+
+  for (i = 0; i < n_revisions; i++) {
+    guint64 revision = GUINT64_TO_BE (revisions[i]);
+
+    memcpy (p, &revision, sizeof (revision));
+    p += sizeof (revision);
+  }
+
+  if (len)
+    memcpy (p, data, len);
+
+  return g_bytes_new_take (msg, GST_SYNC_CONTROL_TCP_HEADER_SIZE +
+      payload_len);
+}
+
+/* Creates a message of the given type with a copy of the given payload,
+ * ready to be written out on the wire */
+GBytes *
+gst_sync_control_tcp_message_new (GstSyncControlTcpMessageType type,
+    gconstpointer data, gsize len)
+{
+  return make_message (type, NULL, 0, data, len);
+}
+
+/* Like gst_sync_control_tcp_message_new(), but the payload starts with the
+ * given revisions. data may be NULL if there is nothing else to send. */
+GBytes *
+gst_sync_control_tcp_message_new_with_revisions (
+    GstSyncControlTcpMessageType type, const guint64 * revisions,
+    guint n_revisions, GBytes * data)
+{
+  gconstpointer d = NULL;
+  gsize len = 0;
+
+  if (data)
+    d = g_bytes_get_data (data, &len);
+
+  return make_message (type, revisions, n_revisions, d, len);
+}
+
+/* Returns the payload size of the first message in buf, or 0 if we don't yet
+ * have the whole header */
+guint32
+gst_sync_control_tcp_message_peek_size (GByteArray * buf)
+{
+  guint32 size;
+
+  if (buf->len < GST_SYNC_CONTROL_TCP_HEADER_SIZE)
+    return 0;
+
+  memcpy (&size, buf->data, sizeof (size));
+
+  return GUINT32_FROM_BE (size);
+}
+
+/* Parses a buffer that contains exactly one message, such as a datagram */
+gboolean
+gst_sync_control_tcp_message_parse (gconstpointer data, gsize len,
+    guint8 * type, GBytes ** payload)
+{
+  const guint8 *msg = data;
+  guint32 size;
+
+  if (len < GST_SYNC_CONTROL_TCP_HEADER_SIZE)
+    return FALSE;
+
+  memcpy (&size, msg, sizeof (size));
+  size = GUINT32_FROM_BE (size);
+
+  if (len - GST_SYNC_CONTROL_TCP_HEADER_SIZE != size)
+    return FALSE;
+
+  *type = msg[4];
+  *payload = g_bytes_new (msg + GST_SYNC_CONTROL_TCP_HEADER_SIZE, size);
+
+  return TRUE;
+}
+
+/* If buf contains at least one complete message, removes the first one from
+ * buf, and returns its type and payload */
+gboolean
+gst_sync_control_tcp_message_pop (GByteArray * buf, guint8 * type,
+    GBytes ** payload)
+{
+  guint32 size;
+
+  if (buf->len < GST_SYNC_CONTROL_TCP_HEADER_SIZE)
+    return FALSE;
+
+  size = gst_sync_control_tcp_message_peek_size (buf);
+  if (buf->len - GST_SYNC_CONTROL_TCP_HEADER_SIZE < size)
+    return FALSE;
+
+  *type = buf->data[4];
+  *payload = g_bytes_new (buf->data + GST_SYNC_CONTROL_TCP_HEADER_SIZE, size);
+
+  g_byte_array_remove_range (buf, 0, GST_SYNC_CONTROL_TCP_HEADER_SIZE + size);
+
+  return TRUE;
+}
+
+/* Reads the revisions at the start of a payload. If rest is not NULL, it is
+ * set to whatever follows them. */
+gboolean
+gst_sync_control_tcp_payload_get_revisions (GBytes * payload,
+    guint64 * revisions, guint n_revisions, GBytes ** rest)
+{
+  const guint8 *data;
+  gsize len, offset;
+  guint i;
+
+  data = g_bytes_get_data (payload, &len);
+  offset = n_revisions * GST_SYNC_CONTROL_TCP_REVISION_SIZE;
+
+  if (len < offset)
+    return FALSE;
+
+  for (i = 0; i < n_revisions; i++) {
+    guint64 revision;
+
+    memcpy (&revision, data + i * GST_SYNC_CONTROL_TCP_REVISION_SIZE,
+        sizeof (revision));
+    revisions[i] = GUINT64_FROM_BE (revision);
+  }
+
+  if (rest)
+    *rest = g_bytes_new_from_bytes (payload, offset, len - offset);
+
+  return TRUE;
+}
+
+/* The payload of a CLIENT_INFO message */
+gchar *
+gst_sync_control_tcp_client_info_new (const gchar * id, GVariant * config)
+{
+  JsonBuilder *builder;
+  JsonNode *node;
+  gchar *ret;
+
+  if (config)
+    g_variant_ref (config);
+  else
+    config = g_variant_ref_sink (g_variant_new ("a{sv}", NULL));
+
+  builder = json_builder_new ();
+
+  json_builder_begin_object (builder);
+
+  json_builder_set_member_name (builder, "id");
+  json_builder_add_string_value (builder, id);
+
+  json_builder_set_member_name (builder, "config");
+  json_builder_add_value (builder, json_gvariant_serialize (config));
+
+  json_builder_end_object (builder);
+
+  node = json_builder_get_root (builder);
+
+  ret = json_to_string (node, FALSE);
+
+  json_node_free (node);
+  g_object_unref (builder);
+  g_variant_unref (config);
+
+  return ret;
+}
+
+gboolean
+gst_sync_control_tcp_client_info_parse (GBytes * payload, gchar ** id,
+    GVariant ** config)
+{
+  JsonParser *parser;
+  JsonNode *node, *member;
+  JsonObject *obj;
+  gconstpointer data;
+  gsize len;
+  gboolean ret = FALSE;
+  GError *err = NULL;
+
+  data = g_bytes_get_data (payload, &len);
+
+  parser = json_parser_new ();
+
+  if (!json_parser_load_from_data (parser, data, len, &err)) {
+    g_message ("Could not parse client info: %s", err->message);
+    g_error_free (err);
+    goto done;
+  }
+
+  node = json_parser_get_root (parser);
+  if (!node || !JSON_NODE_HOLDS_OBJECT (node)) {
+    g_message ("Client info is not a JSON object");
+    goto done;
+  }
+
+  obj = json_node_get_object (node);
+
+  /* This is untrusted data off the network, so don't assume anything about
+   * its members */
+  member = json_object_get_member (obj, "id");
+  if (!member || !JSON_NODE_HOLDS_VALUE (member) ||
+      json_node_get_value_type (member) != G_TYPE_STRING) {
+    g_message ("Client info has no ID");
+    goto done;
+  }
+
+  /* Clients without a config send an empty one, but be lenient */
+  member = json_object_get_member (obj, "config");
+  if (!member || JSON_NODE_HOLDS_NULL (member)) {
+    *config = g_variant_new ("a{sv}", NULL);
+  } else {
+    *config = json_gvariant_deserialize (member, "a{sv}", &err);
+    if (!*config) {
+      g_message ("Could not parse client config: %s",
+          err ? err->message : "unknown error");
+      g_clear_error (&err);
+      goto done;
+    }
+  }
+
+  g_variant_ref_sink (*config);
+  *id = g_strdup (json_object_get_string_member (obj, "id"));
+
+  ret = TRUE;
+
+done:
+  g_object_unref (parser);
+
+  return ret;
+}
+
+#define CLIENT_STATS_TYPE G_VARIANT_TYPE ("(sa{sv})")
+
+/* The payload of a CLIENT_STATS message */
+GBytes *
+gst_sync_control_tcp_client_stats_new (const gchar * id, GVariant * stats)
+{
+  GVariant *variant;
+  GBytes *ret;
+
+  variant = g_variant_ref_sink (g_variant_new ("(s@a{sv})", id, stats));
+
+  if (G_BYTE_ORDER == G_BIG_ENDIAN) {
+    GVariant *swapped = g_variant_byteswap (variant);
+
+    g_variant_unref (variant);
+    variant = swapped;
+  }
+
+  ret = g_variant_get_data_as_bytes (variant);
+  g_variant_unref (variant);
+
+  return ret;
+}
+
+gboolean
+gst_sync_control_tcp_client_stats_parse (GBytes * payload, gchar ** id,
+    GVariant ** stats)
+{
+  GVariant *variant;
+
+  variant = g_variant_ref_sink (g_variant_new_from_bytes (CLIENT_STATS_TYPE,
+        payload, FALSE));
+
+  if (G_BYTE_ORDER == G_BIG_ENDIAN) {
+    GVariant *swapped = g_variant_byteswap (variant);
+
+    g_variant_unref (variant);
+    variant = swapped;
+  }
+
+  /* This is untrusted data off the network */
+  if (!g_variant_is_normal_form (variant)) {
+    g_message ("Ignoring malformed client stats");
+    g_variant_unref (variant);
+    return FALSE;
+  }
+
+  g_variant_get (variant, "(s@a{sv})", id, stats);
+  g_variant_unref (variant);
+
+  return TRUE;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __GST_SYNC_CONTROL_TCP_PROTOCOL_H
+#define __GST_SYNC_CONTROL_TCP_PROTOCOL_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * This is private API, shared between the TCP and UDP control servers and
+ * clients.
+ *
+ * Every message on a TCP control connection is a fixed size header followed
+ * by a payload. The header consists of:
+ *
+ *   - the length of the payload (32-bit unsigned integer, big-endian)
+ *   - the message type (8-bit unsigned integer)
+ *
+ * Messages can be split or coalesced arbitrarily by the network, so readers
+ * accumulate data and pull out complete messages as they become available.
+ *
+ * The UDP transport uses the same messages, with exactly one message per
+ * datagram.
+ */
+
+#define GST_SYNC_CONTROL_TCP_HEADER_SIZE 5
+
+typedef enum {
+  /* Client -> server: JSON object with the client's "id" and "config" */
+  GST_SYNC_CONTROL_TCP_MESSAGE_CLIENT_INFO = 1,
+  /* Server -> client: revision, followed by the serialised
+   * GstSyncServerInfo */
+  GST_SYNC_CONTROL_TCP_MESSAGE_SYNC_INFO = 2,
+  /* Server -> client: base revision and new revision, followed by the
+   * difference between the two from gst_sync_server_info_diff() */
+  GST_SYNC_CONTROL_TCP_MESSAGE_SYNC_INFO_DELTA = 3,
+  /* Client -> server: revision the client has applied */
+  GST_SYNC_CONTROL_TCP_MESSAGE_ACK = 4,
+  /* Client -> server: client could not apply a delta, and needs the full
+   * sync info (empty payload) */
+  GST_SYNC_CONTROL_TCP_MESSAGE_RESYNC = 5,
+  /* Client -> server: client is going away, payload is the client ID (UDP
+   * only, TCP clients just disconnect) */
+  GST_SYNC_CONTROL_TCP_MESSAGE_LEAVE = 6,
+  /* Client -> server: the client's ID and a dictionary of clock statistics,
+   * as a little-endian serialised "(sa{sv})" GVariant */
+  GST_SYNC_CONTROL_TCP_MESSAGE_CLIENT_STATS = 7,
+} GstSyncControlTcpMessageType;
+
+/* Revisions are 64-bit unsigned integers, big-endian */
+#define GST_SYNC_CONTROL_TCP_REVISION_SIZE 8
+
+GBytes * gst_sync_control_tcp_message_new (GstSyncControlTcpMessageType type,
+    gconstpointer data, gsize len);
+GBytes * gst_sync_control_tcp_message_new_with_revisions (
+    GstSyncControlTcpMessageType type, const guint64 * revisions,
+    guint n_revisions, GBytes * data);
+
+guint32 gst_sync_control_tcp_message_peek_size (GByteArray * buf);
+gboolean gst_sync_control_tcp_message_pop (GByteArray * buf, guint8 * type,
+    GBytes ** payload);
+gboolean gst_sync_control_tcp_message_parse (gconstpointer data, gsize len,
+    guint8 * type, GBytes ** payload);
+
+gboolean gst_sync_control_tcp_payload_get_revisions (GBytes * payload,
+    guint64 * revisions, guint n_revisions, GBytes ** rest);
+
+gchar * gst_sync_control_tcp_client_info_new (const gchar * id,
+    GVariant * config);
+gboolean gst_sync_control_tcp_client_info_parse (GBytes * payload,
+    gchar ** id, GVariant ** config);
+
+GBytes * gst_sync_control_tcp_client_stats_new (const gchar * id,
+    GVariant * stats);
+gboolean gst_sync_control_tcp_client_stats_parse (GBytes * payload,
+    gchar ** id, GVariant ** stats);
+
+G_END_DECLS
+
+#endif /* __GST_SYNC_CONTROL_TCP_PROTOCOL_H */
@@ -19,30 +19,109 @@
  */
 
 #include <string.h>
-#include <unistd.h>
 
 #include <glib-object.h>
 #include <gio/gio.h>
-#include <json-glib/json-glib.h>
 
 #include <glib.h>
-#include <glib/gstdio.h>
-#include <glib-unix.h>
 
 #include "sync-server.h"
 #include "sync-control-server.h"
 #include "sync-control-tcp-server.h"
+#include "sync-control-tcp-protocol.h"
+
+/* Each worker runs a main loop on its own thread, and multiplexes a subset of
+ * the client connections. The first worker also accepts new connections. */
+typedef struct {
+  GstSyncControlTcpServer *self;
+
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+
+  GMutex lock;
+  GList *clients;
+
+  /* Set while the worker has been asked to send out new sync info, but has
+   * not started yet. Updates that come in meanwhile are picked up by the
+   * same wakeup. */
+  gint update_pending;
+} Worker;
+
+typedef struct {
+  Worker *worker;
+
+  GSocket *socket;
+  GSource *source;
+  GByteArray *in;
+  gchar *id;
+
+  /* The message we are writing out, if the socket could not take all of it
+   * yet. We never queue anything behind this: once it is written out, the
+   * client gets whatever the latest sync info is at that point. */
+  GBytes *out;
+  gsize out_offset;
+  guint64 out_revision;
+  GSource *out_source;
+  /* When we first could not write out everything, 0 if we are not blocked */
+  gint64 blocked_since;
+
+  /* Last revision we sent, and last revision the client acknowledged. We can
+   * only send a delta if the client has acknowledged everything we sent. */
+  guint64 sent;
+  guint64 acked;
+  /* Whether the last revision we sent had the client's own transform in it,
+   * in which case a shared delta can't take it to a revision without one */
+  gboolean sent_transform;
+} Client;
+
+/* A previous revision of the sync info, so we can send clients just what
+ * changed since the last revision they acknowledged */
+typedef struct {
+  guint64 revision;
+  GstSyncServerInfo *info;
+  /* Delta message from this revision to the latest one for clients without a
+   * transform, created on demand */
+  GBytes *delta;
+} Revision;
 
 struct _GstSyncControlTcpServer {
   GObject parent;
 
   gchar *addr;
   gint port;
+  guint n_threads;
 
   GRWLock info_lock;
   GstSyncServerInfo *info;
-
-  GSocketService *server;
+  /* The serialised form of info, shared by all clients that do not have their
+   * own transform */
+  GBytes *info_bytes;
+  gboolean info_bytes_sent;
+  guint64 revision;
+
+  /* Protects the delta cache in the history, which is updated with just the
+   * reader lock held */
+  GMutex history_lock;
+  GQueue history;
+
+  GMutex stats_lock;
+  guint64 n_encodes;
+  guint64 n_encodes_avoided;
+  guint64 n_delta_encodes;
+  guint64 n_deltas_sent;
+  guint64 n_coalesced;
+  guint64 n_evictions;
+  guint64 queued_bytes;
+  guint blocked_clients;
+
+  guint max_backlog;
+  guint send_timeout;
+
+  GSocket *listener;
+  GSource *listen_source;
+  GPtrArray *workers;
+  guint next_worker;
 };
 
 struct _GstSyncControlTcpServerClass {
@@ -58,13 +137,34 @@ enum {
   PROP_ADDRESS,
   PROP_PORT,
   PROP_SYNC_INFO,
+  PROP_THREADS,
+  PROP_STATS,
+  PROP_MAX_BACKLOG,
+  PROP_SEND_TIMEOUT,
 };
 
+#define DEFAULT_THREADS 1
+#define DEFAULT_MAX_BACKLOG 0
+#define DEFAULT_SEND_TIMEOUT 10000 /* ms */
+/* Client info is small, don't let a broken client make us buffer forever */
+#define MAX_CLIENT_MESSAGE_SIZE (1024 * 1024)
+/* How many old revisions we can send deltas against */
+#define MAX_HISTORY 16
+
 static gboolean
 gst_sync_control_tcp_server_start (GstSyncControlTcpServer * self,
     GError ** err);
-static gboolean
+static void
 gst_sync_control_tcp_server_stop (GstSyncControlTcpServer * self);
+static void broadcast_sync_info (GstSyncControlTcpServer * self);
+static GBytes *encode_sync_info (GstSyncControlTcpServer * self,
+    GstSyncServerInfo * info, guint64 revision);
+static GBytes *encode_shared_sync_info (GstSyncControlTcpServer * self,
+    GstSyncServerInfo * info, guint64 revision);
+static void push_history (GstSyncControlTcpServer * self,
+    GstSyncServerInfo * info, guint64 revision);
+static void revision_free (Revision * rev);
+static GVariant *get_stats (GstSyncControlTcpServer * self);
 
 static void
 gst_sync_control_tcp_server_set_property (GObject * object, guint property_id,
@@ -86,12 +186,37 @@ gst_sync_control_tcp_server_set_property (GObject * object, guint property_id,
 
     case PROP_SYNC_INFO:
       g_rw_lock_writer_lock (&self->info_lock);
+      /* Keep the old info around to send deltas against */
       if (self->info)
-        g_object_unref (self->info);
+        push_history (self, self->info, self->revision);
+      if (self->info_bytes)
+        g_bytes_unref (self->info_bytes);
 
+      self->revision++;
       self->info = g_value_dup_object (value);
+      self->info_bytes = self->info ?
+        encode_shared_sync_info (self, self->info, self->revision) : NULL;
+      self->info_bytes_sent = FALSE;
       g_rw_lock_writer_unlock (&self->info_lock);
 
+      broadcast_sync_info (self);
+      break;
+
+    case PROP_THREADS:
+      if (self->workers) {
+        g_warning ("Trying to set number of threads after server has started");
+        break;
+      }
+
+      self->n_threads = g_value_get_uint (value);
+      break;
+
+    case PROP_MAX_BACKLOG:
+      self->max_backlog = g_value_get_uint (value);
+      break;
+
+    case PROP_SEND_TIMEOUT:
+      self->send_timeout = g_value_get_uint (value);
       break;
 
     default:
@@ -121,6 +246,22 @@ gst_sync_control_tcp_server_get_property (GObject * object, guint property_id,
       g_rw_lock_reader_unlock (&self->info_lock);
       break;
 
+    case PROP_THREADS:
+      g_value_set_uint (value, self->n_threads);
+      break;
+
+    case PROP_STATS:
+      g_value_take_variant (value, get_stats (self));
+      break;
+
+    case PROP_MAX_BACKLOG:
+      g_value_set_uint (value, self->max_backlog);
+      break;
+
+    case PROP_SEND_TIMEOUT:
+      g_value_set_uint (value, self->send_timeout);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -142,217 +283,779 @@ gst_sync_control_tcp_server_dispose (GObject * object)
     self->info = NULL;
   }
 
+  if (self->info_bytes) {
+    g_bytes_unref (self->info_bytes);
+    self->info_bytes = NULL;
+  }
+
+  g_queue_foreach (&self->history, (GFunc) revision_free, NULL);
+  g_queue_clear (&self->history);
+
   g_rw_lock_clear (&self->info_lock);
+  g_mutex_clear (&self->history_lock);
+  g_mutex_clear (&self->stats_lock);
 
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
-static gchar *
-get_client_info (GstSyncControlTcpServer * self, GSocketConnection * conn)
+static GBytes *
+encode_sync_info (GstSyncControlTcpServer * self, GstSyncServerInfo * info,
+    guint64 revision)
 {
-  JsonNode *node = NULL;
-  JsonObject *obj;
-  gchar *id = NULL;
-  GVariant *config = NULL;
-  GInputStream *istream;
-  gchar buf[16384] = { 0, };
-  GError *err = NULL;
+  GBytes *msg, *out;
 
-  istream = g_io_stream_get_input_stream (G_IO_STREAM (conn));
+  out = gst_sync_server_info_to_bytes (info);
+  msg = gst_sync_control_tcp_message_new_with_revisions
+      (GST_SYNC_CONTROL_TCP_MESSAGE_SYNC_INFO, &revision, 1, out);
+  g_bytes_unref (out);
 
-  if (g_input_stream_read (istream, buf, sizeof (buf) - 1, NULL, &err) < 0) {
-    g_message ("Could not read client info: %s", err->message);
-    g_error_free (err);
-    goto done;
-  }
+  g_mutex_lock (&self->stats_lock);
+  self->n_encodes++;
+  g_mutex_unlock (&self->stats_lock);
 
-  node = json_from_string (buf, &err);
-  if (!node) {
-    if (err) {
-      g_message ("Could not parse client info: %s", err->message);
-      g_error_free (err);
+  return msg;
+}
+
+static void
+revision_free (Revision * rev)
+{
+  g_object_unref (rev->info);
+  if (rev->delta)
+    g_bytes_unref (rev->delta);
+  g_free (rev);
+}
+
+/* Called with the info writer lock held, takes ownership of info */
+static void
+push_history (GstSyncControlTcpServer * self, GstSyncServerInfo * info,
+    guint64 revision)
+{
+  Revision *rev;
+  GList *l;
+
+  g_mutex_lock (&self->history_lock);
+
+  /* Cached deltas were against the previous latest revision */
+  for (l = self->history.head; l; l = l->next) {
+    rev = (Revision *) l->data;
+
+    if (rev->delta) {
+      g_bytes_unref (rev->delta);
+      rev->delta = NULL;
     }
-    goto done;
   }
 
-  obj = json_node_get_object (node);
+  rev = g_new0 (Revision, 1);
+  rev->revision = revision;
+  rev->info = info;
+  g_queue_push_head (&self->history, rev);
 
-  config = json_gvariant_deserialize (json_object_get_member (obj, "config"),
-      "a{sv}", &err);
-  if (!config) {
-    g_message ("Could not parse client config: %s", err->message);
-    g_error_free (err);
-    goto done;
-  }
+  if (g_queue_get_length (&self->history) > MAX_HISTORY)
+    revision_free (g_queue_pop_tail (&self->history));
 
-  /* FIXME: can/should we check the id for uniqueness? */
-  id = g_strdup (json_object_get_string_member (obj, "id"));
+  g_mutex_unlock (&self->history_lock);
+}
 
-  g_signal_emit_by_name (self, "client-joined", id,
-      g_variant_ref_sink (config));
+/* Sync info for clients without a transform, this does not depend on the
+ * client so it can be encoded once and shared */
+static GBytes *
+encode_shared_sync_info (GstSyncControlTcpServer * self,
+    GstSyncServerInfo * info, guint64 revision)
+{
+  GstSyncServerInfo *filtered;
+  GBytes *msg;
 
-done:
-  if (config)
-    g_variant_unref (config);
-  if (node)
-    json_node_unref (node);
+  filtered = gst_sync_server_info_filter_transform (info, NULL);
+  msg = encode_sync_info (self, filtered, revision);
+  g_object_unref (filtered);
 
-  return id;
+  return msg;
 }
 
+/* Called with the info lock held. Whether the client has a transform, in
+ * which case it needs sync info of its own. */
 static gboolean
-send_sync_info (GstSyncControlTcpServer * self, GSocket * socket)
+has_transform (GstSyncControlTcpServer * self, const gchar * id)
 {
-  gchar *out;
-  gsize len;
-  GError *err = NULL;
-  gboolean ret = TRUE;
+  GVariant *transform, *entry;
+
+  transform = gst_sync_server_info_get_transform (self->info);
+  if (!transform)
+    return FALSE;
+
+  entry = g_variant_lookup_value (transform, id, NULL);
+  g_variant_unref (transform);
+
+  if (!entry)
+    return FALSE;
+
+  g_variant_unref (entry);
+  return TRUE;
+}
+
+/* Called with the info lock held. id is NULL for clients that had no
+ * transform in either revision */
+static GBytes *
+encode_delta (GstSyncControlTcpServer * self, guint64 base,
+    GstSyncServerInfo * base_info, const gchar * id)
+{
+  GstSyncServerInfo *old_info, *new_info;
+  guint64 revisions[2] = { base, self->revision };
+  GBytes *delta, *msg;
+
+  old_info = gst_sync_server_info_filter_transform (base_info, id);
+  new_info = gst_sync_server_info_filter_transform (self->info, id);
+
+  delta = gst_sync_server_info_diff (old_info, new_info);
+  msg = gst_sync_control_tcp_message_new_with_revisions
+      (GST_SYNC_CONTROL_TCP_MESSAGE_SYNC_INFO_DELTA, revisions, 2, delta);
+
+  g_bytes_unref (delta);
+  g_object_unref (old_info);
+  g_object_unref (new_info);
+
+  g_mutex_lock (&self->stats_lock);
+  self->n_delta_encodes++;
+  g_mutex_unlock (&self->stats_lock);
+
+  return msg;
+}
+
+/* Called with the info reader lock held. Returns the message that takes a
+ * client from the given revision to the latest one, or NULL if a full
+ * snapshot should be sent instead. id is NULL for clients that had no
+ * transform in either revision, whose deltas are shared. */
+static GBytes *
+get_delta (GstSyncControlTcpServer * self, guint64 base, const gchar * id)
+{
+  GBytes *msg = NULL;
+  GList *l;
+
+  g_mutex_lock (&self->history_lock);
+
+  for (l = self->history.head; l; l = l->next) {
+    Revision *rev = (Revision *) l->data;
+
+    if (rev->revision != base)
+      continue;
+
+    if (id) {
+      msg = encode_delta (self, base, rev->info, id);
+    } else {
+      if (!rev->delta)
+        rev->delta = encode_delta (self, base, rev->info, NULL);
+
+      msg = g_bytes_ref (rev->delta);
+    }
+
+    /* No point if the snapshot is (about as) small anyway */
+    if (g_bytes_get_size (msg) >= g_bytes_get_size (self->info_bytes)) {
+      g_bytes_unref (msg);
+      msg = NULL;
+    }
+
+    break;
+  }
+
+  g_mutex_unlock (&self->history_lock);
+
+  return msg;
+}
+
+static GVariant *
+get_stats (GstSyncControlTcpServer * self)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+  g_mutex_lock (&self->stats_lock);
+  g_variant_builder_add (&builder, "{sv}", "encodes",
+      g_variant_new_uint64 (self->n_encodes));
+  g_variant_builder_add (&builder, "{sv}", "encodes-avoided",
+      g_variant_new_uint64 (self->n_encodes_avoided));
+  g_variant_builder_add (&builder, "{sv}", "delta-encodes",
+      g_variant_new_uint64 (self->n_delta_encodes));
+  g_variant_builder_add (&builder, "{sv}", "deltas-sent",
+      g_variant_new_uint64 (self->n_deltas_sent));
+  g_variant_builder_add (&builder, "{sv}", "updates-coalesced",
+      g_variant_new_uint64 (self->n_coalesced));
+  g_variant_builder_add (&builder, "{sv}", "evictions",
+      g_variant_new_uint64 (self->n_evictions));
+  g_variant_builder_add (&builder, "{sv}", "queued-bytes",
+      g_variant_new_uint64 (self->queued_bytes));
+  g_variant_builder_add (&builder, "{sv}", "blocked-clients",
+      g_variant_new_uint32 (self->blocked_clients));
+  g_mutex_unlock (&self->stats_lock);
+
+  return g_variant_builder_end (&builder);
+}
+
+/* Returns the message that brings the client up to date, or NULL if it
+ * already is (or there is nothing to send yet) */
+static GBytes *
+make_sync_info_message (GstSyncControlTcpServer * self, Client * client)
+{
+  GBytes *bytes = NULL;
+  guint64 revision;
+  const gchar *id;
+  gboolean transform, reused = FALSE, delta = FALSE;
 
   g_rw_lock_reader_lock (&self->info_lock);
-  if (!self->info) {
+  revision = self->revision;
+  if (!self->info_bytes || client->sent == revision) {
+    /* Nothing to send, or already up to date */
     g_rw_lock_reader_unlock (&self->info_lock);
-    return FALSE;
+    return NULL;
+  }
+
+  /* Clients with a transform only get their own entry, so they can't share
+   * what we send everyone else */
+  transform = has_transform (self, client->id);
+  id = transform ? client->id : NULL;
+
+  /* If the client has caught up with everything we sent, only send it what
+   * changed since then. If it had a transform then, the delta needs to
+   * include that transform going away too. */
+  if (client->acked && client->acked == client->sent) {
+    bytes = get_delta (self, client->acked,
+        transform || client->sent_transform ? client->id : NULL);
+    delta = bytes != NULL;
+  }
+
+  if (!bytes && id) {
+    GstSyncServerInfo *filtered;
+
+    filtered = gst_sync_server_info_filter_transform (self->info, id);
+    bytes = encode_sync_info (self, filtered, revision);
+    g_object_unref (filtered);
+  } else if (!bytes) {
+    /* Every client gets the same bytes, which were encoded when the info was
+     * set, so all we need to do here is take a reference */
+    bytes = g_bytes_ref (self->info_bytes);
+    reused = !g_atomic_int_compare_and_exchange (&self->info_bytes_sent,
+        FALSE, TRUE);
   }
-  out = json_gobject_to_data (G_OBJECT (self->info), &len);
   g_rw_lock_reader_unlock (&self->info_lock);
 
-  if (g_socket_send (socket, out, len, NULL, &err) != len) {
-    if (err) {
-      g_message ("Could not write out %lu bytes: %s", len, err->message);
+  if (reused || delta) {
+    g_mutex_lock (&self->stats_lock);
+    if (reused)
+      self->n_encodes_avoided++;
+    if (delta)
+      self->n_deltas_sent++;
+    g_mutex_unlock (&self->stats_lock);
+  }
+
+  client->sent = revision;
+  client->sent_transform = transform;
+
+  return bytes;
+}
+
+static void
+set_blocked (GstSyncControlTcpServer * self, Client * client,
+    gboolean blocked)
+{
+  if (blocked == (client->blocked_since != 0))
+    return;
+
+  client->blocked_since = blocked ? g_get_monotonic_time () : 0;
+
+  g_mutex_lock (&self->stats_lock);
+  if (blocked)
+    self->blocked_clients++;
+  else
+    self->blocked_clients--;
+  g_mutex_unlock (&self->stats_lock);
+}
+
+static gboolean flush_client (GstSyncControlTcpServer * self,
+    Client * client);
+
+static gboolean
+client_out_cb (GSocket * socket, GIOCondition cond, gpointer user_data);
+
+/* Starts writing out the latest sync info, if the client does not have it */
+static void
+queue_sync_info (GstSyncControlTcpServer * self, Client * client)
+{
+  guint64 last_revision = client->out_revision;
+
+  client->out = make_sync_info_message (self, client);
+  if (!client->out)
+    return;
+
+  client->out_offset = 0;
+  client->out_revision = client->sent;
+
+  g_mutex_lock (&self->stats_lock);
+  self->queued_bytes += g_bytes_get_size (client->out);
+  /* Revisions that went by while we were still writing an older one */
+  if (last_revision && client->out_revision > last_revision + 1)
+    self->n_coalesced += client->out_revision - last_revision - 1;
+  g_mutex_unlock (&self->stats_lock);
+}
+
+/* Writes out as much as the socket will take without blocking. Returns FALSE
+ * if the connection is broken. */
+static gboolean
+flush_client (GstSyncControlTcpServer * self, Client * client)
+{
+  while (client->out) {
+    const guint8 *data;
+    gsize len;
+    gssize written;
+    GError *err = NULL;
+
+    data = g_bytes_get_data (client->out, &len);
+
+    written = g_socket_send_with_blocking (client->socket,
+        (const gchar *) data + client->out_offset, len - client->out_offset,
+        FALSE, NULL, &err);
+
+    if (written < 0) {
+      if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+        g_error_free (err);
+        break;
+      }
+
+      g_message ("Could not write to client: %s", err->message);
       g_error_free (err);
-    } else
-      g_message ("Wrote out less than one full buffer");
+      return FALSE;
+    }
+
+    client->out_offset += written;
+
+    g_mutex_lock (&self->stats_lock);
+    self->queued_bytes -= written;
+    g_mutex_unlock (&self->stats_lock);
+
+    if (client->out_offset == len) {
+      g_bytes_unref (client->out);
+      client->out = NULL;
+
+      /* Catch up with anything that changed while we were writing */
+      queue_sync_info (self, client);
+    }
+  }
 
-    ret = FALSE;
+  set_blocked (self, client, client->out != NULL);
+
+  /* Wait for the socket to drain if we could not write everything */
+  if (client->out && !client->out_source) {
+    client->out_source = g_socket_create_source (client->socket, G_IO_OUT,
+        NULL);
+    g_source_set_callback (client->out_source, (GSourceFunc) client_out_cb,
+        client, NULL);
+    g_source_attach (client->out_source, client->worker->context);
+  } else if (!client->out && client->out_source) {
+    g_source_destroy (client->out_source);
+    g_source_unref (client->out_source);
+    client->out_source = NULL;
   }
 
-  return ret;
+  return TRUE;
 }
 
+/* Whether a client that is not keeping up should be disconnected */
 static gboolean
-socket_error_cb (GSocket * socket, GIOCondition cond, gpointer user_data)
+should_evict (GstSyncControlTcpServer * self, Client * client)
 {
-  GMainLoop *loop = (GMainLoop *) user_data;
+  guint64 behind;
+  gint64 blocked_for;
 
-  if (cond & G_IO_ERR)
-    g_message ("Got error on a client socket, closing connection");
-  else if (g_socket_is_connected (socket))
-    ; /* Either we have an EOF or some unexpected data, just quit */
+  g_rw_lock_reader_lock (&self->info_lock);
+  behind = self->revision - client->out_revision;
+  g_rw_lock_reader_unlock (&self->info_lock);
+
+  if (self->max_backlog && behind > self->max_backlog) {
+    g_message ("Client %s is %" G_GUINT64_FORMAT " updates behind, "
+        "disconnecting", client->id, behind);
+    return TRUE;
+  }
+
+  blocked_for = g_get_monotonic_time () - client->blocked_since;
+  if (self->send_timeout &&
+      blocked_for > (gint64) self->send_timeout * G_TIME_SPAN_MILLISECOND) {
+    g_message ("Client %s has not taken an update for %" G_GINT64_FORMAT
+        " ms, disconnecting", client->id,
+        blocked_for / G_TIME_SPAN_MILLISECOND);
+    return TRUE;
+  }
 
-  g_main_loop_quit (loop);
   return FALSE;
 }
 
+/* Sends the latest sync info to the client, without blocking. Returns FALSE if
+ * the client should be disconnected. */
+static gboolean
+send_sync_info (GstSyncControlTcpServer * self, Client * client)
+{
+  if (client->out) {
+    /* Still writing out an earlier update. This one gets folded into what we
+     * send once that is done, unless the client is too far behind. */
+    if (should_evict (self, client)) {
+      g_mutex_lock (&self->stats_lock);
+      self->n_evictions++;
+      g_mutex_unlock (&self->stats_lock);
+
+      return FALSE;
+    }
+
+    return TRUE;
+  }
+
+  queue_sync_info (self, client);
+
+  return flush_client (self, client);
+}
+
+/* Called from the client's worker thread, or after all workers are stopped */
 static void
-sync_info_notify (GObject * object, GParamSpec * pspec, gpointer user_data)
+client_free (Client * client)
 {
-  gint fd = GPOINTER_TO_INT (user_data);
-  char c = 0;
+  GstSyncControlTcpServer *self = client->worker->self;
+
+  if (client->id)
+    g_signal_emit_by_name (self, "client-left", client->id);
+
+  g_source_destroy (client->source);
+  g_source_unref (client->source);
+
+  if (client->out_source) {
+    g_source_destroy (client->out_source);
+    g_source_unref (client->out_source);
+  }
+
+  if (client->out) {
+    g_mutex_lock (&self->stats_lock);
+    self->queued_bytes -= g_bytes_get_size (client->out) - client->out_offset;
+    g_mutex_unlock (&self->stats_lock);
+
+    g_bytes_unref (client->out);
+  }
+
+  set_blocked (self, client, FALSE);
 
-  if (write (fd, &c, sizeof (c)) != sizeof (c))
-    g_message ("Failed to write data to fd");
+  g_socket_close (client->socket, NULL);
+  g_object_unref (client->socket);
+
+  g_byte_array_unref (client->in);
+  g_free (client->id);
+  g_free (client);
 }
 
-struct ClientData {
-  GstSyncControlTcpServer *self;
-  GSocket *socket;
-  GMainLoop *loop;
-  gchar *id;
-};
+static gboolean
+handle_message (Client * client, guint8 type, GBytes * payload)
+{
+  GstSyncControlTcpServer *self = client->worker->self;
+  GVariant *config;
+
+  switch (type) {
+    case GST_SYNC_CONTROL_TCP_MESSAGE_CLIENT_INFO:
+      if (client->id) {
+        g_message ("Client %s sent its info twice", client->id);
+        return FALSE;
+      }
+
+      /* Get the ID And config from the client */
+      if (!gst_sync_control_tcp_client_info_parse (payload, &client->id,
+            &config))
+        return FALSE;
+
+      /* FIXME: can/should we check the id for uniqueness? */
+      g_signal_emit_by_name (self, "client-joined", client->id, config);
+      g_variant_unref (config);
+
+      /* Now get the sync info from the server */
+      return send_sync_info (self, client);
+
+    case GST_SYNC_CONTROL_TCP_MESSAGE_ACK: {
+      guint64 revision;
+
+      if (!gst_sync_control_tcp_payload_get_revisions (payload, &revision, 1,
+            NULL))
+        return FALSE;
+
+      /* Ignore stale acks, and anything we never sent */
+      if (revision == client->sent)
+        client->acked = revision;
+
+      return TRUE;
+    }
+
+    case GST_SYNC_CONTROL_TCP_MESSAGE_CLIENT_STATS: {
+      gchar *id;
+      GVariant *stats;
+
+      if (!client->id)
+        return FALSE;
+
+      if (!gst_sync_control_tcp_client_stats_parse (payload, &id, &stats))
+        return FALSE;
+
+      /* We already know who this is, don't let clients speak for others */
+      g_signal_emit_by_name (self, "client-stats", client->id, stats);
+
+      g_free (id);
+      g_variant_unref (stats);
+      return TRUE;
+    }
+
+    case GST_SYNC_CONTROL_TCP_MESSAGE_RESYNC:
+      if (!client->id)
+        return FALSE;
+
+      /* The client lost track, start over with a full snapshot */
+      client->sent = 0;
+      client->acked = 0;
+      return send_sync_info (self, client);
+
+    default:
+      /* Nothing else is expected from clients */
+      g_message ("Unexpected message type %u from client", type);
+      return FALSE;
+  }
+}
+
+/* Called from the client's worker thread */
+static void
+close_client (Client * client)
+{
+  Worker *worker = client->worker;
+
+  g_mutex_lock (&worker->lock);
+  worker->clients = g_list_remove (worker->clients, client);
+  g_mutex_unlock (&worker->lock);
+
+  client_free (client);
+}
 
 static gboolean
-sync_info_updated (gint fd, GIOCondition cond, gpointer user_data)
+client_cb (GSocket * socket, GIOCondition cond, gpointer user_data)
 {
-  struct ClientData *data = (struct ClientData *) user_data;
-  char c;
+  Client *client = (Client *) user_data;
+  gchar buf[4096];
+  gssize len;
+  guint8 type;
+  GBytes *payload;
+  GError *err = NULL;
 
   if (cond & G_IO_ERR) {
-    g_message ("Error reading pipe fd");
-    goto err;
+    g_message ("Got error on a client socket, closing connection");
+    goto close;
   }
 
-  if (read (fd, &c, sizeof (c)) != sizeof (c)) {
-    g_message ("Failed to read data from fd");
-    goto err;
+  len = g_socket_receive_with_blocking (socket, buf, sizeof (buf), FALSE, NULL,
+      &err);
+  if (len < 0) {
+    if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+      g_error_free (err);
+      return G_SOURCE_CONTINUE;
+    }
+
+    g_message ("Could not read from client: %s", err->message);
+    g_error_free (err);
+    goto close;
+  } else if (len == 0) {
+    /* EOF, the client went away */
+    goto close;
   }
 
-  send_sync_info (data->self, data->socket);
+  g_byte_array_append (client->in, (guint8 *) buf, len);
 
-  return TRUE;
+  /* We might have received any number of messages, or a part of one */
+  while (gst_sync_control_tcp_message_pop (client->in, &type, &payload)) {
+    gboolean ok = handle_message (client, type, payload);
 
-err:
-  g_main_loop_quit (data->loop);
-  return FALSE;
+    g_bytes_unref (payload);
+
+    if (!ok)
+      goto close;
+  }
+
+  if (gst_sync_control_tcp_message_peek_size (client->in) >
+      MAX_CLIENT_MESSAGE_SIZE) {
+    g_message ("Message from client is too large, closing connection");
+    goto close;
+  }
+
+  return G_SOURCE_CONTINUE;
+
+close:
+  close_client (client);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+client_out_cb (GSocket * socket, GIOCondition cond, gpointer user_data)
+{
+  Client *client = (Client *) user_data;
+
+  if (!flush_client (client->worker->self, client)) {
+    close_client (client);
+    return G_SOURCE_REMOVE;
+  }
+
+  /* flush_client() removes this source once everything is written */
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+worker_send_sync_info (gpointer user_data)
+{
+  Worker *worker = (Worker *) user_data;
+  GList *l, *failed = NULL;
+
+  /* Anything set after this point needs another wakeup */
+  g_atomic_int_set (&worker->update_pending, FALSE);
+
+  g_mutex_lock (&worker->lock);
+
+  for (l = worker->clients; l; l = l->next) {
+    Client *client = (Client *) l->data;
+
+    /* Clients get sync info once they have sent their info */
+    if (client->id && !send_sync_info (worker->self, client))
+      failed = g_list_prepend (failed, client);
+  }
+
+  g_mutex_unlock (&worker->lock);
+
+  for (l = failed; l; l = l->next)
+    close_client ((Client *) l->data);
+
+  g_list_free (failed);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+broadcast_sync_info (GstSyncControlTcpServer * self)
+{
+  guint i;
+
+  if (!self->workers)
+    return;
+
+  /* Have each worker send out the new info to its clients. This is a single
+   * wakeup per worker regardless of the number of clients, and none at all if
+   * the worker has not got around to the previous update yet, since it always
+   * sends the latest info. */
+  for (i = 0; i < self->workers->len; i++) {
+    Worker *worker = g_ptr_array_index (self->workers, i);
+
+    if (g_atomic_int_compare_and_exchange (&worker->update_pending, FALSE,
+          TRUE))
+      g_main_context_invoke (worker->context, worker_send_sync_info, worker);
+  }
 }
 
 static gboolean
-run_cb (GThreadedSocketService * service, GSocketConnection * connection,
-    GObject * source_object G_GNUC_UNUSED, gpointer user_data)
+accept_cb (GSocket * listener, GIOCondition cond, gpointer user_data)
 {
   GstSyncControlTcpServer *self = GST_SYNC_CONTROL_TCP_SERVER (user_data);
   GSocket *socket;
-  GSource *err_source, *pipe_source;
-  GMainLoop *loop;
-  gint fds[2] = { -1, };
-  gulong sig_id;
-  struct ClientData d = { 0, };
-  GError *err;
-
-  socket = g_socket_connection_get_socket (connection);
-  loop = g_main_loop_new (g_main_context_get_thread_default (), FALSE);
-
-  d.self = self;
-  d.socket = socket;
-  d.loop = loop;
-
-  /* Get the ID And config from the client */
-  d.id = get_client_info (self, connection);
-  if (!d.id)
-    goto done;
-
-  /* Now get the sync info from the server */
-  send_sync_info (self, socket);
-
-  /* Catch errors (at this point, any input after the client info is also
-   * unexpected) on the socket and exit cleanly */
-  err_source = g_socket_create_source (socket, G_IO_IN | G_IO_ERR, NULL);
-  g_source_set_callback (err_source, (GSourceFunc) socket_error_cb, loop, NULL);
-  g_source_attach (err_source, g_main_context_get_thread_default ());
-
-  /* We get a notification every time sync-info changes, and dispatch that to
-   * the client thread */
-  if (!g_unix_open_pipe (fds, 0, &err)) {
-    g_warning ("Could not create pipe: %s", err->message);
+  Worker *worker;
+  Client *client;
+  GError *err = NULL;
+
+  socket = g_socket_accept (listener, NULL, &err);
+  if (!socket) {
+    if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+      g_message ("Could not accept connection: %s", err->message);
+
     g_error_free (err);
-    goto done;
+    return G_SOURCE_CONTINUE;
   }
 
-  pipe_source = g_unix_fd_source_new (fds[0], G_IO_IN | G_IO_ERR);
-  g_source_set_callback (pipe_source, (GSourceFunc) sync_info_updated, &d,
+  /* Spread clients across workers */
+  worker = g_ptr_array_index (self->workers,
+      self->next_worker++ % self->workers->len);
+
+  client = g_new0 (Client, 1);
+  client->worker = worker;
+  client->socket = socket;
+  client->in = g_byte_array_new ();
+
+  /* We never want to block a worker on a slow client */
+  g_socket_set_blocking (socket, FALSE);
+
+  client->source =
+    g_socket_create_source (socket, G_IO_IN | G_IO_ERR | G_IO_HUP, NULL);
+  g_source_set_callback (client->source, (GSourceFunc) client_cb, client,
       NULL);
-  g_source_attach (pipe_source, g_main_context_get_thread_default ());
 
-  sig_id = g_signal_connect (self, "notify::sync-info",
-      G_CALLBACK (sync_info_notify), GINT_TO_POINTER (fds[1]));
+  g_mutex_lock (&worker->lock);
+  worker->clients = g_list_prepend (worker->clients, client);
+  g_source_attach (client->source, worker->context);
+  g_mutex_unlock (&worker->lock);
 
-  /* Now loop until we're done */
-  g_main_loop_run (loop);
+  return G_SOURCE_CONTINUE;
+}
 
-  g_signal_handler_disconnect (self, sig_id);
+static gpointer
+worker_thread (gpointer user_data)
+{
+  Worker *worker = (Worker *) user_data;
 
-  g_source_destroy (err_source);
-  g_source_destroy (pipe_source);
+  g_main_context_push_thread_default (worker->context);
+  g_main_loop_run (worker->loop);
+  g_main_context_pop_thread_default (worker->context);
 
-  g_signal_emit_by_name (self, "client-left", d.id);
+  return NULL;
+}
 
-done:
-  g_close (fds[0], NULL);
-  g_close (fds[1], NULL);
+static Worker *
+worker_new (GstSyncControlTcpServer * self)
+{
+  Worker *worker;
 
-  g_free (d.id);
+  worker = g_new0 (Worker, 1);
 
-  g_main_loop_unref (loop);
-  return TRUE;
+  worker->self = self;
+  worker->context = g_main_context_new ();
+  worker->loop = g_main_loop_new (worker->context, FALSE);
+  g_mutex_init (&worker->lock);
+
+  return worker;
+}
+
+static gboolean
+worker_quit (gpointer user_data)
+{
+  Worker *worker = (Worker *) user_data;
+
+  g_main_loop_quit (worker->loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+worker_free (Worker * worker)
+{
+  if (worker->thread) {
+    GSource *source;
+
+    /* Quit from inside the loop, so we don't race with it starting up */
+    source = g_idle_source_new ();
+    g_source_set_callback (source, worker_quit, worker, NULL);
+    g_source_attach (source, worker->context);
+    g_source_unref (source);
+
+    g_thread_join (worker->thread);
+  }
+
+  /* The thread is gone, so we can clean up the remaining clients here */
+  g_list_free_full (worker->clients, (GDestroyNotify) client_free);
+
+  g_mutex_clear (&worker->lock);
+  g_main_loop_unref (worker->loop);
+  g_main_context_unref (worker->context);
+
+  g_free (worker);
 }
 
 static void
@@ -368,6 +1071,69 @@ gst_sync_control_tcp_server_class_init (GstSyncControlTcpServerClass * klass)
   g_object_class_override_property (object_class, PROP_PORT, "port");
   g_object_class_override_property (object_class, PROP_SYNC_INFO, "sync-info");
 
+  /**
+   * GstSyncControlTcpServer:threads:
+   *
+   * The number of threads used to service client connections. Each thread
+   * runs a single event loop that handles a share of all connected clients,
+   * so this does not need to grow with the number of clients.
+   */
+  g_object_class_install_property (object_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads",
+        "Number of threads to service client connections with", 1, 256,
+        DEFAULT_THREADS,
+        G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncControlTcpServer:stats:
+   *
+   * Statistics about the server as a #GVariant dictionary. "encodes" is the
+   * number of times sync info was serialised, and "encodes-avoided" is the
+   * number of times a client was sent an already serialised copy instead.
+   * "delta-encodes" is the number of deltas between revisions that were
+   * serialised, and "deltas-sent" the number of times a client was sent a
+   * delta instead of the full sync info.
+   *
+   * Clients that do not read fast enough are only ever sent the latest sync
+   * info once they catch up. "updates-coalesced" is the number of updates
+   * clients skipped this way, and "evictions" the number of clients that
+   * were disconnected for falling too far behind (see
+   * #GstSyncControlTcpServer:max-backlog and
+   * #GstSyncControlTcpServer:send-timeout). "queued-bytes" is the amount of
+   * data waiting to be written out to clients, and "blocked-clients" the
+   * number of clients that data is waiting for.
+   */
+  g_object_class_install_property (object_class, PROP_STATS,
+      g_param_spec_variant ("stats", "Statistics", "Server statistics",
+        G_VARIANT_TYPE_VARDICT, NULL,
+        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncControlTcpServer:max-backlog:
+   *
+   * The number of updates a client can fall behind by while we are still
+   * writing out an earlier one to it, before it is disconnected. 0 means
+   * there is no limit.
+   */
+  g_object_class_install_property (object_class, PROP_MAX_BACKLOG,
+      g_param_spec_uint ("max-backlog", "Maximum backlog",
+        "Number of updates a client may fall behind by before it is "
+        "disconnected (0 = unlimited)", 0, G_MAXUINT, DEFAULT_MAX_BACKLOG,
+        G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncControlTcpServer:send-timeout:
+   *
+   * How long (in milliseconds) a client can take to read an update before it
+   * is disconnected. This is checked when there is a new update to send. 0
+   * means clients are never disconnected for being slow.
+   */
+  g_object_class_install_property (object_class, PROP_SEND_TIMEOUT,
+      g_param_spec_uint ("send-timeout", "Send timeout",
+        "Time a client may take to read an update before it is disconnected "
+        "(ms, 0 = unlimited)", 0, G_MAXUINT, DEFAULT_SEND_TIMEOUT,
+        G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
   g_signal_override_class_handler ("start", GST_TYPE_SYNC_CONTROL_TCP_SERVER,
       G_CALLBACK (gst_sync_control_tcp_server_start));
   g_signal_override_class_handler ("stop", GST_TYPE_SYNC_CONTROL_TCP_SERVER,
@@ -379,38 +1145,124 @@ gst_sync_control_tcp_server_init (GstSyncControlTcpServer *self)
 {
   self->addr = NULL;
   self->port = 0;
+  self->n_threads = DEFAULT_THREADS;
 
   g_rw_lock_init (&self->info_lock);
   self->info = NULL;
+  self->info_bytes = NULL;
+  self->info_bytes_sent = FALSE;
+  self->revision = 0;
+
+  g_mutex_init (&self->history_lock);
+  g_queue_init (&self->history);
+
+  g_mutex_init (&self->stats_lock);
+  self->n_encodes = 0;
+  self->n_encodes_avoided = 0;
+  self->n_delta_encodes = 0;
+  self->n_deltas_sent = 0;
+  self->n_coalesced = 0;
+  self->n_evictions = 0;
+  self->queued_bytes = 0;
+  self->blocked_clients = 0;
+
+  self->max_backlog = DEFAULT_MAX_BACKLOG;
+  self->send_timeout = DEFAULT_SEND_TIMEOUT;
+
+  self->listener = NULL;
+  self->listen_source = NULL;
+  self->workers = NULL;
+  self->next_worker = 0;
 }
 
 static gboolean
 gst_sync_control_tcp_server_start (GstSyncControlTcpServer * self,
     GError ** err)
 {
-  /* We have address and port set, so we can start the socket service */
+  /* We have address and port set, so we can start listening */
   GSocketAddress *sockaddr;
+  Worker *worker;
+  guint i;
 
-  self->server = g_threaded_socket_service_new (-1);
+  sockaddr = g_inet_socket_address_new_from_string (self->addr, self->port);
+  if (!sockaddr) {
+    g_set_error (err, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+        "Invalid control address: %s", self->addr);
+    return FALSE;
+  }
 
-  g_signal_connect (self->server, "run", G_CALLBACK (run_cb), self);
+  self->listener = g_socket_new (g_socket_address_get_family (sockaddr),
+      G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, err);
+  if (!self->listener)
+    goto fail;
 
-  sockaddr = g_inet_socket_address_new_from_string (self->addr, self->port);
+  g_socket_set_blocking (self->listener, FALSE);
 
-  if (!g_socket_listener_add_address (G_SOCKET_LISTENER (self->server),
-        sockaddr, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP, NULL, NULL,
-        err))
-    return FALSE;
+  if (!g_socket_bind (self->listener, sockaddr, TRUE, err) ||
+      !g_socket_listen (self->listener, err))
+    goto fail;
+
+  if (self->port == 0) {
+    /* Let users find out which port we actually got */
+    GSocketAddress *local;
+
+    local = g_socket_get_local_address (self->listener, NULL);
+    if (local) {
+      self->port =
+        g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (local));
+      g_object_unref (local);
+    }
+  }
+
+  self->workers =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) worker_free);
+  for (i = 0; i < self->n_threads; i++)
+    g_ptr_array_add (self->workers, worker_new (self));
+
+  /* The first worker also accepts new connections */
+  worker = g_ptr_array_index (self->workers, 0);
+
+  self->listen_source = g_socket_create_source (self->listener, G_IO_IN, NULL);
+  g_source_set_callback (self->listen_source, (GSourceFunc) accept_cb, self,
+      NULL);
+  g_source_attach (self->listen_source, worker->context);
+
+  for (i = 0; i < self->workers->len; i++) {
+    worker = g_ptr_array_index (self->workers, i);
+    worker->thread = g_thread_new ("sync-control", worker_thread, worker);
+  }
+
+  g_object_unref (sockaddr);
 
   return TRUE;
+
+fail:
+  g_object_unref (sockaddr);
+  gst_sync_control_tcp_server_stop (self);
+
+  return FALSE;
 }
 
-static gboolean
+static void
 gst_sync_control_tcp_server_stop (GstSyncControlTcpServer * self)
 {
-  if (self->server) {
-    g_socket_service_stop (self->server);
-    g_object_unref (self->server);
-    self->server = NULL;
+  if (self->listen_source) {
+    g_source_destroy (self->listen_source);
+    g_source_unref (self->listen_source);
+    self->listen_source = NULL;
+  }
+
+  if (self->workers) {
+    GPtrArray *workers = self->workers;
+
+    /* Stops all the worker threads and disconnects clients */
+    self->workers = NULL;
+    g_ptr_array_free (workers, TRUE);
+  }
+
+  if (self->listener) {
+    g_socket_close (self->listener, NULL);
+    g_object_unref (self->listener);
+    self->listener = NULL;
   }
 }
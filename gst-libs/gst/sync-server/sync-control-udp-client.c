@@ -0,0 +1,631 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * The client side of the UDP control transport. Sync information is received
+ * on the multicast group, while our info, repair requests and leave
+ * notifications are sent to the server's unicast address from a separate
+ * socket. The server only accepts those from the address we joined from, and
+ * answers repair requests on the group.
+ */
+
+#include <string.h>
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "sync-server.h"
+#include "sync-client.h"
+#include "sync-control-client.h"
+#include "sync-control-udp-client.h"
+#include "sync-control-tcp-protocol.h"
+
+struct _GstSyncControlUdpClient {
+  GObject parent;
+
+  gchar *id;
+  GVariant *config;
+
+  gchar *addr;
+  gint port;
+  gchar *group;
+  gint group_port;
+  GstSyncServerInfo *info;
+  guint64 revision;
+  gboolean resync_pending;
+
+  GSocketAddress *server_addr;
+  /* Receives updates sent to the group */
+  GSocket *mcast_socket;
+  /* Talks to the server directly */
+  GSocket *socket;
+  GSource *mcast_source;
+  GSource *source;
+  GSource *timer_source;
+  guint8 buf[65536];
+};
+
+struct _GstSyncControlUdpClientClass {
+  GObjectClass parent;
+};
+
+#define gst_sync_control_udp_client_parent_class parent_class
+G_DEFINE_TYPE_WITH_CODE (GstSyncControlUdpClient, gst_sync_control_udp_client,
+    G_TYPE_OBJECT, G_IMPLEMENT_INTERFACE (GST_TYPE_SYNC_CONTROL_CLIENT, NULL));
+
+enum {
+  PROP_0,
+  PROP_ID,
+  PROP_CONFIG,
+  PROP_ADDRESS,
+  PROP_PORT,
+  PROP_SYNC_INFO,
+  PROP_MULTICAST_GROUP,
+  PROP_MULTICAST_PORT,
+};
+
+#define DEFAULT_MULTICAST_GROUP "239.255.42.42"
+#define DEFAULT_MULTICAST_PORT 3696
+
+/* How often we remind the server that we exist (ms) */
+#define KEEPALIVE_INTERVAL 2000
+
+static void gst_sync_control_udp_client_stop (GstSyncControlUdpClient * self);
+
+static void
+gst_sync_control_udp_client_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstSyncControlUdpClient *self = GST_SYNC_CONTROL_UDP_CLIENT (object);
+
+  switch (property_id) {
+    case PROP_ID:
+      if (self->socket) {
+        g_warning ("Trying to set client ID after it has started");
+        break;
+      }
+
+      g_free (self->id);
+      self->id = g_value_dup_string (value);
+
+      break;
+
+    case PROP_CONFIG:
+      if (self->socket) {
+        g_warning ("Trying to set client config after it has started");
+        break;
+      }
+
+      if (self->config)
+        g_variant_unref (self->config);
+
+      self->config = g_value_dup_variant (value);
+
+      break;
+
+    case PROP_ADDRESS:
+      g_free (self->addr);
+      self->addr = g_value_dup_string (value);
+
+      break;
+
+    case PROP_PORT:
+      self->port = g_value_get_int (value);
+      break;
+
+    case PROP_MULTICAST_GROUP:
+      g_free (self->group);
+      self->group = g_value_dup_string (value);
+
+      break;
+
+    case PROP_MULTICAST_PORT:
+      self->group_port = g_value_get_int (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_sync_control_udp_client_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstSyncControlUdpClient *self = GST_SYNC_CONTROL_UDP_CLIENT (object);
+
+  switch (property_id) {
+    case PROP_ID:
+      g_value_set_string (value, self->id);
+      break;
+
+    case PROP_CONFIG:
+      g_value_set_variant (value, self->config);
+      break;
+
+    case PROP_ADDRESS:
+      g_value_set_string (value, self->addr);
+      break;
+
+    case PROP_PORT:
+      g_value_set_int (value, self->port);
+      break;
+
+    case PROP_SYNC_INFO:
+      g_value_set_object (value, self->info);
+      break;
+
+    case PROP_MULTICAST_GROUP:
+      g_value_set_string (value, self->group);
+      break;
+
+    case PROP_MULTICAST_PORT:
+      g_value_set_int (value, self->group_port);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_sync_control_udp_client_dispose (GObject * object)
+{
+  GstSyncControlUdpClient *self = GST_SYNC_CONTROL_UDP_CLIENT (object);
+
+  gst_sync_control_udp_client_stop (self);
+
+  g_free (self->id);
+  self->id = NULL;
+
+  if (self->config) {
+    g_variant_unref (self->config);
+    self->config = NULL;
+  }
+
+  g_free (self->addr);
+  self->addr = NULL;
+
+  g_free (self->group);
+  self->group = NULL;
+
+  if (self->info) {
+    g_object_unref (self->info);
+    self->info = NULL;
+  }
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
+}
+
+/* Takes ownership of msg */
+static void
+send_message (GstSyncControlUdpClient * self, GBytes * msg)
+{
+  gconstpointer data;
+  gsize len;
+  GError *err = NULL;
+
+  data = g_bytes_get_data (msg, &len);
+
+  /* Everything we send is repeated if it gets lost, so just carry on */
+  if (g_socket_send_to (self->socket, self->server_addr, data, len, NULL,
+        &err) < 0) {
+    g_message ("Could not send message: %s", err->message);
+    g_error_free (err);
+  }
+
+  g_bytes_unref (msg);
+}
+
+static void
+send_client_info (GstSyncControlUdpClient * self)
+{
+  gchar *info;
+
+  info = gst_sync_control_tcp_client_info_new (self->id, self->config);
+  send_message (self, gst_sync_control_tcp_message_new
+      (GST_SYNC_CONTROL_TCP_MESSAGE_CLIENT_INFO, info, strlen (info)));
+  g_free (info);
+}
+
+static void
+send_resync (GstSyncControlUdpClient * self)
+{
+  self->resync_pending = TRUE;
+
+  /* The server needs to know who we are, we have no connection */
+  send_message (self, gst_sync_control_tcp_message_new
+      (GST_SYNC_CONTROL_TCP_MESSAGE_RESYNC, self->id, strlen (self->id)));
+}
+
+static void
+set_sync_info (GstSyncControlUdpClient * self, GstSyncServerInfo * info,
+    guint64 revision)
+{
+  if (self->info)
+    g_object_unref (self->info);
+  self->info = info;
+  self->revision = revision;
+
+  g_object_notify (G_OBJECT (self), "sync-info");
+}
+
+static void
+handle_sync_info (GstSyncControlUdpClient * self, GBytes * payload)
+{
+  GstSyncServerInfo *info;
+  GBytes *data;
+  guint64 revision;
+  GError *err = NULL;
+
+  if (!gst_sync_control_tcp_payload_get_revisions (payload, &revision, 1,
+        &data)) {
+    g_warning ("Got truncated sync info");
+    return;
+  }
+
+  /* The full information is retransmitted periodically, and can also arrive
+   * both via the group and directly, so most of these are not news */
+  if (self->info && revision <= self->revision) {
+    g_bytes_unref (data);
+    return;
+  }
+
+  info = gst_sync_server_info_from_bytes (data, &err);
+  g_bytes_unref (data);
+
+  if (!info) {
+    g_warning ("Could not parse sync info: %s", err->message);
+    g_error_free (err);
+    return;
+  }
+
+  self->resync_pending = FALSE;
+  set_sync_info (self, info, revision);
+}
+
+static void
+handle_sync_info_delta (GstSyncControlUdpClient * self, GBytes * payload)
+{
+  GstSyncServerInfo *info;
+  GBytes *data;
+  guint64 revisions[2];
+  GError *err = NULL;
+
+  if (!gst_sync_control_tcp_payload_get_revisions (payload, revisions, 2,
+        &data)) {
+    g_warning ("Got truncated sync info delta");
+    return;
+  }
+
+  if (self->info && revisions[1] <= self->revision) {
+    /* Already have this one */
+    g_bytes_unref (data);
+    return;
+  }
+
+  info = NULL;
+  if (self->info && revisions[0] == self->revision) {
+    info = gst_sync_server_info_patch (self->info, data, &err);
+
+    if (!info) {
+      g_warning ("Could not apply sync info delta: %s", err->message);
+      g_error_free (err);
+    }
+  }
+
+  g_bytes_unref (data);
+
+  if (!info) {
+    /* We missed an update, so ask for the full information rather than
+     * waiting for the next retransmission */
+    if (!self->resync_pending)
+      send_resync (self);
+    return;
+  }
+
+  set_sync_info (self, info, revisions[1]);
+}
+
+static gboolean
+recv_cb (GSocket * socket, GIOCondition cond, gpointer user_data)
+{
+  GstSyncControlUdpClient *self = GST_SYNC_CONTROL_UDP_CLIENT (user_data);
+  gssize len;
+  guint8 type;
+  GBytes *payload;
+  GError *err = NULL;
+
+  len = g_socket_receive (socket, (gchar *) self->buf, sizeof (self->buf),
+      NULL, &err);
+  if (len < 0) {
+    if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+      g_message ("Could not receive datagram: %s", err->message);
+
+    g_error_free (err);
+    return G_SOURCE_CONTINUE;
+  }
+
+  if (!gst_sync_control_tcp_message_parse (self->buf, len, &type, &payload)) {
+    g_message ("Ignoring malformed datagram");
+    return G_SOURCE_CONTINUE;
+  }
+
+  switch (type) {
+    case GST_SYNC_CONTROL_TCP_MESSAGE_SYNC_INFO:
+      handle_sync_info (self, payload);
+      break;
+
+    case GST_SYNC_CONTROL_TCP_MESSAGE_SYNC_INFO_DELTA:
+      handle_sync_info_delta (self, payload);
+      break;
+
+    default:
+      /* Could be another client's message if it shares our group */
+      break;
+  }
+
+  g_bytes_unref (payload);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+keepalive_cb (gpointer user_data)
+{
+  GstSyncControlUdpClient *self = GST_SYNC_CONTROL_UDP_CLIENT (user_data);
+
+  /* This also takes care of our first message getting lost */
+  send_client_info (self);
+
+  if (!self->info)
+    send_resync (self);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static GSource *
+add_socket_source (GSocket * socket, gpointer user_data)
+{
+  GSource *source;
+
+  source = g_socket_create_source (socket, G_IO_IN, NULL);
+  g_source_set_callback (source, (GSourceFunc) recv_cb, user_data, NULL);
+  g_source_attach (source, g_main_context_get_thread_default ());
+
+  return source;
+}
+
+static gboolean
+gst_sync_control_udp_client_start (GstSyncControlUdpClient * self,
+    GError ** err)
+{
+  GInetAddress *group = NULL, *any;
+  GSocketAddress *sockaddr;
+  gboolean ret;
+
+  self->server_addr =
+    g_inet_socket_address_new_from_string (self->addr, self->port);
+  if (!self->server_addr) {
+    g_set_error (err, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+        "Invalid control address: %s", self->addr);
+    goto fail;
+  }
+
+  group = self->group ? g_inet_address_new_from_string (self->group) : NULL;
+  if (!group || !g_inet_address_get_is_multicast (group)) {
+    g_set_error (err, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+        "Invalid multicast group: %s", self->group);
+    goto fail;
+  }
+
+  /* Group socket: bound to the group port on all interfaces, shared with
+   * any other clients on this host */
+  self->mcast_socket = g_socket_new (g_inet_address_get_family (group),
+      G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, err);
+  if (!self->mcast_socket)
+    goto fail;
+
+  g_socket_set_blocking (self->mcast_socket, FALSE);
+
+  any = g_inet_address_new_any (g_inet_address_get_family (group));
+  sockaddr = g_inet_socket_address_new (any, self->group_port);
+  ret = g_socket_bind (self->mcast_socket, sockaddr, TRUE, err);
+  g_object_unref (sockaddr);
+  g_object_unref (any);
+
+  if (!ret)
+    goto fail;
+
+  if (!g_socket_join_multicast_group (self->mcast_socket, group, FALSE, NULL,
+        err))
+    goto fail;
+
+  /* Unicast socket, on an ephemeral port */
+  self->socket =
+    g_socket_new (g_socket_address_get_family (self->server_addr),
+        G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, err);
+  if (!self->socket)
+    goto fail;
+
+  g_socket_set_blocking (self->socket, FALSE);
+
+  any = g_inet_address_new_any
+    (g_socket_address_get_family (self->server_addr));
+  sockaddr = g_inet_socket_address_new (any, 0);
+  ret = g_socket_bind (self->socket, sockaddr, FALSE, err);
+  g_object_unref (sockaddr);
+  g_object_unref (any);
+
+  if (!ret)
+    goto fail;
+
+  self->mcast_source = add_socket_source (self->mcast_socket, self);
+  self->source = add_socket_source (self->socket, self);
+
+  self->timer_source = g_timeout_source_new (KEEPALIVE_INTERVAL);
+  g_source_set_callback (self->timer_source, keepalive_cb, self, NULL);
+  g_source_attach (self->timer_source, g_main_context_get_thread_default ());
+
+  /* The sync info reaches us with the server's next retransmission, or when
+   * the keepalive asks for it */
+  send_client_info (self);
+
+  g_object_unref (group);
+
+  return TRUE;
+
+fail:
+  if (group)
+    g_object_unref (group);
+  gst_sync_control_udp_client_stop (self);
+
+  return FALSE;
+}
+
+static void
+gst_sync_control_udp_client_stop (GstSyncControlUdpClient * self)
+{
+  if (self->socket && self->server_addr && self->id) {
+    /* Saves the server from waiting for us to time out */
+    send_message (self, gst_sync_control_tcp_message_new
+        (GST_SYNC_CONTROL_TCP_MESSAGE_LEAVE, self->id, strlen (self->id)));
+  }
+
+  if (self->mcast_source) {
+    g_source_destroy (self->mcast_source);
+    g_source_unref (self->mcast_source);
+    self->mcast_source = NULL;
+  }
+
+  if (self->source) {
+    g_source_destroy (self->source);
+    g_source_unref (self->source);
+    self->source = NULL;
+  }
+
+  if (self->timer_source) {
+    g_source_destroy (self->timer_source);
+    g_source_unref (self->timer_source);
+    self->timer_source = NULL;
+  }
+
+  if (self->mcast_socket) {
+    g_socket_close (self->mcast_socket, NULL);
+    g_object_unref (self->mcast_socket);
+    self->mcast_socket = NULL;
+  }
+
+  if (self->socket) {
+    g_socket_close (self->socket, NULL);
+    g_object_unref (self->socket);
+    self->socket = NULL;
+  }
+
+  g_clear_object (&self->server_addr);
+
+  self->resync_pending = FALSE;
+}
+
+static void
+gst_sync_control_udp_client_report_stats (GstSyncControlUdpClient * self,
+    GVariant * stats)
+{
+  GBytes *payload;
+  gconstpointer data;
+  gsize len;
+
+  if (!self->socket)
+    return;
+
+  payload = gst_sync_control_tcp_client_stats_new (self->id, stats);
+  data = g_bytes_get_data (payload, &len);
+
+  send_message (self, gst_sync_control_tcp_message_new
+      (GST_SYNC_CONTROL_TCP_MESSAGE_CLIENT_STATS, data, len));
+
+  g_bytes_unref (payload);
+}
+
+static void
+gst_sync_control_udp_client_class_init (GstSyncControlUdpClientClass * klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = gst_sync_control_udp_client_dispose;
+  object_class->set_property = gst_sync_control_udp_client_set_property;
+  object_class->get_property = gst_sync_control_udp_client_get_property;
+
+  g_object_class_override_property (object_class, PROP_ID, "id");
+  g_object_class_override_property (object_class, PROP_CONFIG, "config");
+  g_object_class_override_property (object_class, PROP_ADDRESS, "address");
+  g_object_class_override_property (object_class, PROP_PORT, "port");
+  g_object_class_override_property (object_class, PROP_SYNC_INFO, "sync-info");
+
+  /**
+   * GstSyncControlUdpClient:multicast-group:
+   *
+   * The multicast group the server sends sync information to.
+   */
+  g_object_class_install_property (object_class, PROP_MULTICAST_GROUP,
+      g_param_spec_string ("multicast-group", "Multicast group",
+        "Multicast group to receive sync information on",
+        DEFAULT_MULTICAST_GROUP,
+        G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncControlUdpClient:multicast-port:
+   *
+   * The port the server sends sync information to on the multicast group.
+   */
+  g_object_class_install_property (object_class, PROP_MULTICAST_PORT,
+      g_param_spec_int ("multicast-port", "Multicast port",
+        "Port to receive sync information on", 1, 65535,
+        DEFAULT_MULTICAST_PORT,
+        G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  g_signal_override_class_handler ("start", GST_TYPE_SYNC_CONTROL_UDP_CLIENT,
+      G_CALLBACK (gst_sync_control_udp_client_start));
+  g_signal_override_class_handler ("stop", GST_TYPE_SYNC_CONTROL_UDP_CLIENT,
+      G_CALLBACK (gst_sync_control_udp_client_stop));
+  g_signal_override_class_handler ("report-stats",
+      GST_TYPE_SYNC_CONTROL_UDP_CLIENT,
+      G_CALLBACK (gst_sync_control_udp_client_report_stats));
+}
+
+static void
+gst_sync_control_udp_client_init (GstSyncControlUdpClient *self)
+{
+  self->addr = NULL;
+  self->port = 0;
+
+  self->info = NULL;
+  self->revision = 0;
+  self->resync_pending = FALSE;
+
+  self->server_addr = NULL;
+  self->mcast_socket = NULL;
+  self->socket = NULL;
+  self->mcast_source = NULL;
+  self->source = NULL;
+  self->timer_source = NULL;
+}
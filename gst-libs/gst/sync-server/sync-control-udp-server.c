@@ -0,0 +1,830 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * A control server that sends sync information to a multicast group, so that
+ * every update is a single datagram regardless of how many clients there are.
+ *
+ * Each update is sent as a delta against the previous revision (or as the full
+ * information if that is smaller). The full information is also sent to the
+ * group periodically, so that clients that join late or miss an update catch
+ * up. Clients send their info to the server's unicast address when they join
+ * and periodically after that, and can ask for the full information to be
+ * resent to the group if they miss an update.
+ *
+ * Nothing here is authenticated, so we never reply to the address a datagram
+ * claims to come from, and only accept messages about a client from the
+ * address it joined from.
+ *
+ * Messages use the same format as the TCP transport, one per datagram. This
+ * means that the sync information must fit in a single datagram.
+ */
+
+#include <string.h>
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include <glib.h>
+
+#include "sync-server.h"
+#include "sync-control-server.h"
+#include "sync-control-udp-server.h"
+#include "sync-control-tcp-protocol.h"
+
+typedef struct {
+  GSocketAddress *addr;
+  gint64 last_seen;
+} Client;
+
+struct _GstSyncControlUdpServer {
+  GObject parent;
+
+  gchar *addr;
+  gint port;
+  gchar *group;
+  gint group_port;
+  guint ttl;
+  gboolean loopback;
+  guint retransmit_interval;
+
+  GMutex lock;
+  GstSyncServerInfo *info;
+  guint64 revision;
+  /* Full sync info, and what to send the group for the latest update */
+  GBytes *info_msg;
+  GBytes *update_msg;
+
+  /* Only used from the server thread */
+  GHashTable *clients;
+  gint64 last_resync;
+  guint8 buf[65536];
+
+  GSocket *socket;
+  GSocketAddress *group_addr;
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+  GSource *recv_source;
+  GSource *timer_source;
+};
+
+struct _GstSyncControlUdpServerClass {
+  GObjectClass parent;
+};
+
+#define gst_sync_control_udp_server_parent_class parent_class
+G_DEFINE_TYPE_WITH_CODE (GstSyncControlUdpServer, gst_sync_control_udp_server,
+    G_TYPE_OBJECT, G_IMPLEMENT_INTERFACE (GST_TYPE_SYNC_CONTROL_SERVER, NULL));
+
+enum {
+  PROP_0,
+  PROP_ADDRESS,
+  PROP_PORT,
+  PROP_SYNC_INFO,
+  PROP_MULTICAST_GROUP,
+  PROP_MULTICAST_PORT,
+  PROP_MULTICAST_TTL,
+  PROP_MULTICAST_LOOPBACK,
+  PROP_RETRANSMIT_INTERVAL,
+};
+
+#define DEFAULT_MULTICAST_GROUP "239.255.42.42"
+#define DEFAULT_MULTICAST_PORT 3696
+#define DEFAULT_MULTICAST_TTL 1
+#define DEFAULT_MULTICAST_LOOPBACK TRUE
+#define DEFAULT_RETRANSMIT_INTERVAL 1000 /* ms */
+
+/* Clients refresh their info every couple of seconds, and are considered gone
+ * if we don't hear from them for a while */
+#define CLIENT_TIMEOUT (10 * G_TIME_SPAN_SECOND)
+
+/* How often we resend the full sync info to the group at most, however many
+ * clients ask for it */
+#define MIN_RESYNC_INTERVAL (100 * G_TIME_SPAN_MILLISECOND)
+
+/* Largest UDP payload over IPv4 */
+#define MAX_DATAGRAM_SIZE 65507
+
+static gboolean
+gst_sync_control_udp_server_start (GstSyncControlUdpServer * self,
+    GError ** err);
+static void
+gst_sync_control_udp_server_stop (GstSyncControlUdpServer * self);
+static void set_sync_info (GstSyncControlUdpServer * self,
+    GstSyncServerInfo * info);
+
+static void
+gst_sync_control_udp_server_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstSyncControlUdpServer *self = GST_SYNC_CONTROL_UDP_SERVER (object);
+
+  switch (property_id) {
+    case PROP_ADDRESS:
+      g_free (self->addr);
+      self->addr = g_value_dup_string (value);
+      break;
+
+    case PROP_PORT:
+      self->port = g_value_get_int (value);
+      break;
+
+    case PROP_SYNC_INFO:
+      set_sync_info (self, g_value_get_object (value));
+      break;
+
+    case PROP_MULTICAST_GROUP:
+      g_free (self->group);
+      self->group = g_value_dup_string (value);
+      break;
+
+    case PROP_MULTICAST_PORT:
+      self->group_port = g_value_get_int (value);
+      break;
+
+    case PROP_MULTICAST_TTL:
+      self->ttl = g_value_get_uint (value);
+      break;
+
+    case PROP_MULTICAST_LOOPBACK:
+      self->loopback = g_value_get_boolean (value);
+      break;
+
+    case PROP_RETRANSMIT_INTERVAL:
+      self->retransmit_interval = g_value_get_uint (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_sync_control_udp_server_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstSyncControlUdpServer *self = GST_SYNC_CONTROL_UDP_SERVER (object);
+
+  switch (property_id) {
+    case PROP_ADDRESS:
+      g_value_set_string (value, self->addr);
+      break;
+
+    case PROP_PORT:
+      g_value_set_int (value, self->port);
+      break;
+
+    case PROP_SYNC_INFO:
+      g_mutex_lock (&self->lock);
+      g_value_set_object (value, self->info);
+      g_mutex_unlock (&self->lock);
+      break;
+
+    case PROP_MULTICAST_GROUP:
+      g_value_set_string (value, self->group);
+      break;
+
+    case PROP_MULTICAST_PORT:
+      g_value_set_int (value, self->group_port);
+      break;
+
+    case PROP_MULTICAST_TTL:
+      g_value_set_uint (value, self->ttl);
+      break;
+
+    case PROP_MULTICAST_LOOPBACK:
+      g_value_set_boolean (value, self->loopback);
+      break;
+
+    case PROP_RETRANSMIT_INTERVAL:
+      g_value_set_uint (value, self->retransmit_interval);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_sync_control_udp_server_dispose (GObject * object)
+{
+  GstSyncControlUdpServer *self = GST_SYNC_CONTROL_UDP_SERVER (object);
+
+  gst_sync_control_udp_server_stop (self);
+
+  g_free (self->addr);
+  self->addr = NULL;
+
+  g_free (self->group);
+  self->group = NULL;
+
+  g_clear_object (&self->info);
+
+  if (self->info_msg) {
+    g_bytes_unref (self->info_msg);
+    self->info_msg = NULL;
+  }
+
+  if (self->update_msg) {
+    g_bytes_unref (self->update_msg);
+    self->update_msg = NULL;
+  }
+
+  if (self->clients) {
+    g_hash_table_unref (self->clients);
+    self->clients = NULL;
+  }
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
+}
+
+static void
+gst_sync_control_udp_server_finalize (GObject * object)
+{
+  GstSyncControlUdpServer *self = GST_SYNC_CONTROL_UDP_SERVER (object);
+
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+client_free (Client * client)
+{
+  g_object_unref (client->addr);
+  g_free (client);
+}
+
+static gboolean
+same_address (GSocketAddress * a, GSocketAddress * b)
+{
+  GInetSocketAddress *ia, *ib;
+
+  if (!G_IS_INET_SOCKET_ADDRESS (a) || !G_IS_INET_SOCKET_ADDRESS (b))
+    return FALSE;
+
+  ia = G_INET_SOCKET_ADDRESS (a);
+  ib = G_INET_SOCKET_ADDRESS (b);
+
+  return g_inet_socket_address_get_port (ia) ==
+    g_inet_socket_address_get_port (ib) &&
+    g_inet_address_equal (g_inet_socket_address_get_address (ia),
+        g_inet_socket_address_get_address (ib));
+}
+
+/* Looks up a client, but only if the message came from where the client
+ * joined from, so that others can't speak for it */
+static Client *
+lookup_client (GstSyncControlUdpServer * self, const gchar * id,
+    GSocketAddress * from)
+{
+  Client *client;
+
+  client = g_hash_table_lookup (self->clients, id);
+  if (client && !same_address (client->addr, from))
+    return NULL;
+
+  return client;
+}
+
+static void
+send_to (GstSyncControlUdpServer * self, GSocketAddress * addr, GBytes * msg)
+{
+  gconstpointer data;
+  gsize len;
+  GError *err = NULL;
+
+  data = g_bytes_get_data (msg, &len);
+
+  /* If this doesn't make it, the periodic retransmission or a repair request
+   * will take care of things */
+  if (g_socket_send_to (self->socket, addr, data, len, NULL, &err) < 0) {
+    g_message ("Could not send %" G_GSIZE_FORMAT " byte datagram: %s", len,
+        err->message);
+    g_error_free (err);
+  }
+}
+
+/* Sends the full sync info to the group */
+static void
+send_sync_info (GstSyncControlUdpServer * self)
+{
+  GBytes *msg = NULL;
+
+  g_mutex_lock (&self->lock);
+  if (self->info_msg)
+    msg = g_bytes_ref (self->info_msg);
+  g_mutex_unlock (&self->lock);
+
+  if (!msg)
+    return;
+
+  send_to (self, self->group_addr, msg);
+  g_bytes_unref (msg);
+}
+
+static gboolean
+send_update (gpointer user_data)
+{
+  GstSyncControlUdpServer *self = GST_SYNC_CONTROL_UDP_SERVER (user_data);
+  GBytes *msg = NULL;
+
+  g_mutex_lock (&self->lock);
+  if (self->update_msg)
+    msg = g_bytes_ref (self->update_msg);
+  g_mutex_unlock (&self->lock);
+
+  if (msg) {
+    send_to (self, self->group_addr, msg);
+    g_bytes_unref (msg);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+set_sync_info (GstSyncControlUdpServer * self, GstSyncServerInfo * info)
+{
+  GBytes *delta_msg = NULL;
+
+  g_mutex_lock (&self->lock);
+
+  self->revision++;
+
+  /* Clients that have the previous revision only need what changed */
+  if (self->info && info) {
+    guint64 revisions[2] = { self->revision - 1, self->revision };
+    GBytes *delta;
+
+    delta = gst_sync_server_info_diff (self->info, info);
+    delta_msg = gst_sync_control_tcp_message_new_with_revisions
+        (GST_SYNC_CONTROL_TCP_MESSAGE_SYNC_INFO_DELTA, revisions, 2, delta);
+    g_bytes_unref (delta);
+  }
+
+  g_clear_object (&self->info);
+  if (self->info_msg)
+    g_bytes_unref (self->info_msg);
+  if (self->update_msg)
+    g_bytes_unref (self->update_msg);
+
+  self->info = info ? g_object_ref (info) : NULL;
+  self->info_msg = NULL;
+  self->update_msg = NULL;
+
+  if (self->info) {
+    GBytes *bytes = gst_sync_server_info_to_bytes (self->info);
+
+    self->info_msg = gst_sync_control_tcp_message_new_with_revisions
+        (GST_SYNC_CONTROL_TCP_MESSAGE_SYNC_INFO, &self->revision, 1, bytes);
+    g_bytes_unref (bytes);
+
+    if (g_bytes_get_size (self->info_msg) > MAX_DATAGRAM_SIZE) {
+      g_warning ("Sync info is too large for a datagram (%" G_GSIZE_FORMAT
+          " bytes), clients will not receive it",
+          g_bytes_get_size (self->info_msg));
+    }
+
+    if (delta_msg &&
+        g_bytes_get_size (delta_msg) < g_bytes_get_size (self->info_msg))
+      self->update_msg = g_bytes_ref (delta_msg);
+    else
+      self->update_msg = g_bytes_ref (self->info_msg);
+  }
+
+  g_mutex_unlock (&self->lock);
+
+  if (delta_msg)
+    g_bytes_unref (delta_msg);
+
+  if (self->context)
+    g_main_context_invoke (self->context, send_update, self);
+}
+
+static gboolean
+retransmit_cb (gpointer user_data)
+{
+  GstSyncControlUdpServer *self = GST_SYNC_CONTROL_UDP_SERVER (user_data);
+  GHashTableIter iter;
+  gpointer id, client;
+  gint64 now;
+
+  /* For clients that joined late or missed the last update */
+  send_sync_info (self);
+
+  now = g_get_monotonic_time ();
+
+  g_hash_table_iter_init (&iter, self->clients);
+  while (g_hash_table_iter_next (&iter, &id, &client)) {
+    if (now - ((Client *) client)->last_seen > CLIENT_TIMEOUT) {
+      g_signal_emit_by_name (self, "client-left", id);
+      g_hash_table_iter_remove (&iter);
+    }
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+handle_message (GstSyncControlUdpServer * self, GSocketAddress * from,
+    guint8 type, GBytes * payload)
+{
+  Client *client;
+  gchar *id;
+  GVariant *config;
+  gconstpointer data;
+  gsize len;
+
+  switch (type) {
+    case GST_SYNC_CONTROL_TCP_MESSAGE_CLIENT_INFO:
+      if (!gst_sync_control_tcp_client_info_parse (payload, &id, &config))
+        return;
+
+      if (g_hash_table_contains (self->clients, id)) {
+        /* Just a refresh. If the client now talks to us from elsewhere (it
+         * might have restarted), we pick that up once the old entry times
+         * out. */
+        client = lookup_client (self, id, from);
+        if (client)
+          client->last_seen = g_get_monotonic_time ();
+
+        g_free (id);
+      } else {
+        client = g_new0 (Client, 1);
+        client->addr = g_object_ref (from);
+        client->last_seen = g_get_monotonic_time ();
+
+        /* Takes ownership of id */
+        g_hash_table_insert (self->clients, id, client);
+
+        /* We don't reply with the sync info here, since anyone can send us
+         * this with a forged source address. New clients get it from the
+         * next retransmission, or by asking for a resync. */
+        g_signal_emit_by_name (self, "client-joined", id, config);
+      }
+
+      g_variant_unref (config);
+      break;
+
+    case GST_SYNC_CONTROL_TCP_MESSAGE_RESYNC:
+      data = g_bytes_get_data (payload, &len);
+      id = g_strndup (data, len);
+
+      /* We don't reply to the sender, which might be forged, but resend to
+       * the group that clients listen on anyway. Limit how often, so a flood
+       * of requests can't be turned into a flood of sync info. */
+      client = lookup_client (self, id, from);
+      if (client && g_get_monotonic_time () - self->last_resync >=
+          MIN_RESYNC_INTERVAL) {
+        self->last_resync = g_get_monotonic_time ();
+        send_sync_info (self);
+      }
+
+      g_free (id);
+      break;
+
+    case GST_SYNC_CONTROL_TCP_MESSAGE_CLIENT_STATS: {
+      GVariant *stats;
+
+      if (!gst_sync_control_tcp_client_stats_parse (payload, &id, &stats))
+        return;
+
+      if (lookup_client (self, id, from))
+        g_signal_emit_by_name (self, "client-stats", id, stats);
+
+      g_free (id);
+      g_variant_unref (stats);
+      break;
+    }
+
+    case GST_SYNC_CONTROL_TCP_MESSAGE_LEAVE:
+      data = g_bytes_get_data (payload, &len);
+      id = g_strndup (data, len);
+
+      if (lookup_client (self, id, from)) {
+        g_signal_emit_by_name (self, "client-left", id);
+        g_hash_table_remove (self->clients, id);
+      }
+
+      g_free (id);
+      break;
+
+    default:
+      /* Clients don't acknowledge updates over UDP */
+      break;
+  }
+}
+
+static gboolean
+recv_cb (GSocket * socket, GIOCondition cond, gpointer user_data)
+{
+  GstSyncControlUdpServer *self = GST_SYNC_CONTROL_UDP_SERVER (user_data);
+  GSocketAddress *from = NULL;
+  gssize len;
+  guint8 type;
+  GBytes *payload;
+  GError *err = NULL;
+
+  len = g_socket_receive_from (socket, &from, (gchar *) self->buf,
+      sizeof (self->buf), NULL, &err);
+  if (len < 0) {
+    if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+      g_message ("Could not receive datagram: %s", err->message);
+
+    g_error_free (err);
+    return G_SOURCE_CONTINUE;
+  }
+
+  if (gst_sync_control_tcp_message_parse (self->buf, len, &type, &payload)) {
+    handle_message (self, from, type, payload);
+    g_bytes_unref (payload);
+  } else
+    g_message ("Ignoring malformed datagram");
+
+  g_object_unref (from);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gpointer
+server_thread (gpointer user_data)
+{
+  GstSyncControlUdpServer *self = GST_SYNC_CONTROL_UDP_SERVER (user_data);
+
+  g_main_context_push_thread_default (self->context);
+  g_main_loop_run (self->loop);
+  g_main_context_pop_thread_default (self->context);
+
+  return NULL;
+}
+
+static gboolean
+server_quit (gpointer user_data)
+{
+  GstSyncControlUdpServer *self = GST_SYNC_CONTROL_UDP_SERVER (user_data);
+
+  g_main_loop_quit (self->loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gst_sync_control_udp_server_class_init (GstSyncControlUdpServerClass * klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = gst_sync_control_udp_server_dispose;
+  object_class->finalize = gst_sync_control_udp_server_finalize;
+  object_class->set_property = gst_sync_control_udp_server_set_property;
+  object_class->get_property = gst_sync_control_udp_server_get_property;
+
+  g_object_class_override_property (object_class, PROP_ADDRESS, "address");
+  g_object_class_override_property (object_class, PROP_PORT, "port");
+  g_object_class_override_property (object_class, PROP_SYNC_INFO, "sync-info");
+
+  /**
+   * GstSyncControlUdpServer:multicast-group:
+   *
+   * The multicast group that sync information is sent to. Clients must be
+   * configured with the same group.
+   */
+  g_object_class_install_property (object_class, PROP_MULTICAST_GROUP,
+      g_param_spec_string ("multicast-group", "Multicast group",
+        "Multicast group to send sync information to",
+        DEFAULT_MULTICAST_GROUP,
+        G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncControlUdpServer:multicast-port:
+   *
+   * The port that sync information is sent to on the multicast group.
+   */
+  g_object_class_install_property (object_class, PROP_MULTICAST_PORT,
+      g_param_spec_int ("multicast-port", "Multicast port",
+        "Port to send sync information to on the multicast group", 1, 65535,
+        DEFAULT_MULTICAST_PORT,
+        G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncControlUdpServer:multicast-ttl:
+   *
+   * The time-to-live of multicast datagrams. The default of 1 keeps them on
+   * the local network.
+   */
+  g_object_class_install_property (object_class, PROP_MULTICAST_TTL,
+      g_param_spec_uint ("multicast-ttl", "Multicast TTL",
+        "Time-to-live of multicast datagrams", 0, 255, DEFAULT_MULTICAST_TTL,
+        G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncControlUdpServer:multicast-loopback:
+   *
+   * Whether multicast datagrams are also delivered on the local host, which
+   * is needed for clients running on the same machine as the server.
+   */
+  g_object_class_install_property (object_class, PROP_MULTICAST_LOOPBACK,
+      g_param_spec_boolean ("multicast-loopback", "Multicast loopback",
+        "Deliver multicast datagrams to the local host too",
+        DEFAULT_MULTICAST_LOOPBACK,
+        G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncControlUdpServer:retransmit-interval:
+   *
+   * How often the full sync information is sent to the group (in
+   * milliseconds), for clients that have joined late or missed an update.
+   */
+  g_object_class_install_property (object_class, PROP_RETRANSMIT_INTERVAL,
+      g_param_spec_uint ("retransmit-interval", "Retransmit interval",
+        "Interval between full sync information retransmissions (ms)", 10,
+        G_MAXUINT, DEFAULT_RETRANSMIT_INTERVAL,
+        G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
+
+  g_signal_override_class_handler ("start", GST_TYPE_SYNC_CONTROL_UDP_SERVER,
+      G_CALLBACK (gst_sync_control_udp_server_start));
+  g_signal_override_class_handler ("stop", GST_TYPE_SYNC_CONTROL_UDP_SERVER,
+      G_CALLBACK (gst_sync_control_udp_server_stop));
+}
+
+static void
+gst_sync_control_udp_server_init (GstSyncControlUdpServer *self)
+{
+  self->addr = NULL;
+  self->port = 0;
+
+  g_mutex_init (&self->lock);
+  self->info = NULL;
+  /* Start from the current time, so that clients don't take updates after a
+   * server restart to be older than what they have */
+  self->revision = g_get_real_time ();
+  self->info_msg = NULL;
+  self->update_msg = NULL;
+
+  self->clients = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) client_free);
+
+  self->socket = NULL;
+  self->group_addr = NULL;
+  self->context = NULL;
+  self->loop = NULL;
+  self->thread = NULL;
+  self->recv_source = NULL;
+  self->timer_source = NULL;
+}
+
+static gboolean
+gst_sync_control_udp_server_start (GstSyncControlUdpServer * self,
+    GError ** err)
+{
+  GSocketAddress *sockaddr;
+  GInetAddress *group;
+
+  sockaddr = g_inet_socket_address_new_from_string (self->addr, self->port);
+  if (!sockaddr) {
+    g_set_error (err, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+        "Invalid control address: %s", self->addr);
+    return FALSE;
+  }
+
+  group = self->group ? g_inet_address_new_from_string (self->group) : NULL;
+  if (!group || !g_inet_address_get_is_multicast (group)) {
+    g_set_error (err, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+        "Invalid multicast group: %s", self->group);
+    goto fail;
+  }
+
+  self->group_addr = g_inet_socket_address_new (group, self->group_port);
+
+  self->socket = g_socket_new (g_socket_address_get_family (sockaddr),
+      G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, err);
+  if (!self->socket)
+    goto fail;
+
+  g_socket_set_blocking (self->socket, FALSE);
+  g_socket_set_multicast_ttl (self->socket, self->ttl);
+  g_socket_set_multicast_loopback (self->socket, self->loopback);
+
+  if (!g_socket_bind (self->socket, sockaddr, TRUE, err))
+    goto fail;
+
+  if (self->port == 0) {
+    /* Let users find out which port we actually got */
+    GSocketAddress *local;
+
+    local = g_socket_get_local_address (self->socket, NULL);
+    if (local) {
+      self->port =
+        g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (local));
+      g_object_unref (local);
+    }
+  }
+
+  self->context = g_main_context_new ();
+  self->loop = g_main_loop_new (self->context, FALSE);
+
+  self->recv_source = g_socket_create_source (self->socket, G_IO_IN, NULL);
+  g_source_set_callback (self->recv_source, (GSourceFunc) recv_cb, self,
+      NULL);
+  g_source_attach (self->recv_source, self->context);
+
+  self->timer_source = g_timeout_source_new (self->retransmit_interval);
+  g_source_set_callback (self->timer_source, retransmit_cb, self, NULL);
+  g_source_attach (self->timer_source, self->context);
+
+  self->thread = g_thread_new ("sync-control", server_thread, self);
+
+  /* Send out whatever we already have */
+  g_main_context_invoke (self->context, send_update, self);
+
+  g_object_unref (group);
+  g_object_unref (sockaddr);
+
+  return TRUE;
+
+fail:
+  if (group)
+    g_object_unref (group);
+  g_object_unref (sockaddr);
+  gst_sync_control_udp_server_stop (self);
+
+  return FALSE;
+}
+
+static void
+gst_sync_control_udp_server_stop (GstSyncControlUdpServer * self)
+{
+  GHashTableIter iter;
+  gpointer id;
+
+  if (self->thread) {
+    GSource *source;
+
+    /* Quit from inside the loop, so we don't race with it starting up */
+    source = g_idle_source_new ();
+    g_source_set_callback (source, server_quit, self, NULL);
+    g_source_attach (source, self->context);
+    g_source_unref (source);
+
+    g_thread_join (self->thread);
+    self->thread = NULL;
+  }
+
+  if (self->recv_source) {
+    g_source_destroy (self->recv_source);
+    g_source_unref (self->recv_source);
+    self->recv_source = NULL;
+  }
+
+  if (self->timer_source) {
+    g_source_destroy (self->timer_source);
+    g_source_unref (self->timer_source);
+    self->timer_source = NULL;
+  }
+
+  if (self->loop) {
+    g_main_loop_unref (self->loop);
+    self->loop = NULL;
+  }
+
+  if (self->context) {
+    g_main_context_unref (self->context);
+    self->context = NULL;
+  }
+
+  if (self->socket) {
+    g_socket_close (self->socket, NULL);
+    g_object_unref (self->socket);
+    self->socket = NULL;
+  }
+
+  g_clear_object (&self->group_addr);
+
+  /* The thread is gone, so we can drop the remaining clients here */
+  if (self->clients) {
+    g_hash_table_iter_init (&iter, self->clients);
+    while (g_hash_table_iter_next (&iter, &id, NULL)) {
+      g_signal_emit_by_name (self, "client-left", id);
+      g_hash_table_iter_remove (&iter);
+    }
+  }
+}
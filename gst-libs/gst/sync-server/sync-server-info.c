@@ -27,6 +27,27 @@
  * the library. This is only exposed so that implementations of
  * #GstSyncControlServer and #GstSyncControlClient have access to the
  * information that needs to be sent across the wire.
+ *
+ * The #GstSyncServerInfo:version property selects how the object is encoded by
+ * gst_sync_server_info_to_bytes(). Version 1 is JSON, and version 2 is the
+ * serialised form of a #GVariant dictionary of properties, which is more
+ * compact and much cheaper to decode. gst_sync_server_info_from_bytes()
+ * accepts either.
+ *
+ * #GstSyncServerInfo:clock-type selects the clock that clients synchronise
+ * against. For the network and NTP clocks, #GstSyncServerInfo:clock-address
+ * and #GstSyncServerInfo:clock-port say where to find the time provider or
+ * NTP server. The PTP clock uses #GstSyncServerInfo:ptp-domain instead.
+ * #GstSyncServerInfo:clock-min-poll-interval tells clients how often they may
+ * poll the server's time provider at most.
+ *
+ * A non-zero #GstSyncServerInfo:pending-latency announces the latency that
+ * will take over from #GstSyncServerInfo:latency at the next track boundary.
+ * Clients that advance to the next track on their own switch to it there, so
+ * everyone changes latency at the same point in the timeline.
+ *
+ * The #GstSyncServerInfo:transform dictionary that a client receives may only
+ * contain that client's own entry, see gst_sync_server_info_filter_transform().
  */
 #include <json-glib/json-glib.h>
 
@@ -39,10 +60,14 @@ struct _GstSyncServerInfo {
   guint64 version;
   gchar *clock_addr;
   guint clock_port;
+  GstSyncServerClockType clock_type;
+  guint ptp_domain;
+  guint64 clock_min_poll_interval;
   GVariant *playlist;
   GVariant *transform;
   guint64 base_time;
   guint64 latency;
+  guint64 pending_latency;
   gboolean stopped;
   gboolean paused;
   guint64 base_time_offset;
@@ -73,16 +98,26 @@ G_DEFINE_TYPE_WITH_CODE (GstSyncServerInfo, gst_sync_server_info,
     G_TYPE_OBJECT, G_IMPLEMENT_INTERFACE (JSON_TYPE_SERIALIZABLE,
       gst_sync_server_info_json_iface_init));
 
-#define DEFAULT_VERSION 1
+#define DEFAULT_VERSION GST_SYNC_SERVER_INFO_VERSION_JSON
+
+/* Properties that changed, and properties that were unset */
+#define DELTA_FORMAT_STRING "(a{sv}as)"
+
+#define GST_SYNC_SERVER_INFO_ERROR \
+  (g_quark_from_static_string ("gst-sync-server-info-error-quark"))
 
 enum {
   PROP_0,
   PROP_VERSION,
   PROP_CLOCK_ADDRESS,
   PROP_CLOCK_PORT,
+  PROP_CLOCK_TYPE,
+  PROP_PTP_DOMAIN,
+  PROP_CLOCK_MIN_POLL_INTERVAL,
   PROP_PLAYLIST,
   PROP_BASE_TIME,
   PROP_LATENCY,
+  PROP_PENDING_LATENCY,
   PROP_STOPPED,
   PROP_PAUSED,
   PROP_BASE_TIME_OFFSET,
@@ -185,6 +220,18 @@ gst_sync_server_info_set_property (GObject * object, guint property_id,
       info->clock_port = g_value_get_uint (value);
       break;
 
+    case PROP_CLOCK_TYPE:
+      info->clock_type = g_value_get_enum (value);
+      break;
+
+    case PROP_PTP_DOMAIN:
+      info->ptp_domain = g_value_get_uint (value);
+      break;
+
+    case PROP_CLOCK_MIN_POLL_INTERVAL:
+      info->clock_min_poll_interval = g_value_get_uint64 (value);
+      break;
+
     case PROP_PLAYLIST:
       if (info->playlist)
         g_variant_unref (info->playlist);
@@ -200,6 +247,10 @@ gst_sync_server_info_set_property (GObject * object, guint property_id,
       info->latency = g_value_get_uint64 (value);
       break;
 
+    case PROP_PENDING_LATENCY:
+      info->pending_latency = g_value_get_uint64 (value);
+      break;
+
     case PROP_STOPPED:
       info->stopped = g_value_get_boolean (value);
       break;
@@ -248,6 +299,18 @@ gst_sync_server_info_get_property (GObject * object, guint property_id,
       g_value_set_uint (value, info->clock_port);
       break;
 
+    case PROP_CLOCK_TYPE:
+      g_value_set_enum (value, info->clock_type);
+      break;
+
+    case PROP_PTP_DOMAIN:
+      g_value_set_uint (value, info->ptp_domain);
+      break;
+
+    case PROP_CLOCK_MIN_POLL_INTERVAL:
+      g_value_set_uint64 (value, info->clock_min_poll_interval);
+      break;
+
     case PROP_PLAYLIST:
       g_value_set_variant (value, info->playlist);
       break;
@@ -260,6 +323,10 @@ gst_sync_server_info_get_property (GObject * object, guint property_id,
       g_value_set_uint64 (value, info->latency);
       break;
 
+    case PROP_PENDING_LATENCY:
+      g_value_set_uint64 (value, info->pending_latency);
+      break;
+
     case PROP_STOPPED:
       g_value_set_boolean (value, info->stopped);
       break;
@@ -297,7 +364,8 @@ gst_sync_server_info_class_init (GstSyncServerInfoClass * klass)
 
   g_object_class_install_property (object_class, PROP_VERSION,
       g_param_spec_uint64 ("version", "Version",
-        "Protocol version of the sync information", 0, G_MAXUINT64,
+        "Protocol version of the sync information (1 = JSON, 2 = binary)",
+        0, G_MAXUINT64,
         DEFAULT_VERSION,
         G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
@@ -311,6 +379,24 @@ gst_sync_server_info_class_init (GstSyncServerInfoClass * klass)
         "Network port of the clock provider", 0, 65535, 0,
         G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class, PROP_CLOCK_TYPE,
+      g_param_spec_enum ("clock-type", "Clock type",
+        "Type of clock to synchronise against",
+        GST_TYPE_SYNC_SERVER_CLOCK_TYPE, GST_SYNC_SERVER_CLOCK_TYPE_NET,
+        G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_PTP_DOMAIN,
+      g_param_spec_uint ("ptp-domain", "PTP domain",
+        "PTP domain to use with the PTP clock type", 0, 255, 0,
+        G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_CLOCK_MIN_POLL_INTERVAL,
+      g_param_spec_uint64 ("clock-min-poll-interval",
+        "Clock minimum poll interval",
+        "Shortest interval at which clients may poll the clock provider "
+        "(ns, 0 = no limit)", 0, G_MAXUINT64, 0,
+        G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (object_class, PROP_PLAYLIST,
       g_param_spec_variant ("playlist", "Playlist",
         "Playlist as a current track index, and array of URI and durations",
@@ -332,6 +418,12 @@ gst_sync_server_info_class_init (GstSyncServerInfoClass * klass)
         "Latency of the GStreamer pipeline (ns)", 0, G_MAXUINT64, 0,
         G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class, PROP_PENDING_LATENCY,
+      g_param_spec_uint64 ("pending-latency", "Pending latency",
+        "Latency to use from the next track on (ns, 0 = no change)", 0,
+        G_MAXUINT64, 0,
+        G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (object_class, PROP_STREAM_START_DELAY,
       g_param_spec_uint64 ("stream-start-delay", "Stream start delay",
         "Delay before starting a stream (ns)", 0, G_MAXUINT64, 0,
@@ -367,6 +459,341 @@ gst_sync_server_info_new ()
   return g_object_new (GST_TYPE_SYNC_SERVER_INFO, NULL);
 }
 
+static GVariant *
+value_to_variant (const GValue * value)
+{
+  switch (G_TYPE_FUNDAMENTAL (G_VALUE_TYPE (value))) {
+    case G_TYPE_BOOLEAN:
+      return g_variant_new_boolean (g_value_get_boolean (value));
+
+    case G_TYPE_INT:
+      return g_variant_new_int32 (g_value_get_int (value));
+
+    case G_TYPE_UINT:
+      return g_variant_new_uint32 (g_value_get_uint (value));
+
+    case G_TYPE_UINT64:
+      return g_variant_new_uint64 (g_value_get_uint64 (value));
+
+    case G_TYPE_ENUM:
+      return g_variant_new_int32 (g_value_get_enum (value));
+
+    case G_TYPE_STRING:
+      if (!g_value_get_string (value))
+        return NULL;
+      return g_variant_new_string (g_value_get_string (value));
+
+    case G_TYPE_VARIANT:
+      /* Unset (NULL) variants are just left out */
+      return g_value_get_variant (value);
+
+    default:
+      g_warn_if_reached ();
+      return NULL;
+  }
+}
+
+static gboolean
+variant_to_value (GVariant * variant, GParamSpec * pspec, GValue * value)
+{
+  const GVariantType *type;
+
+  switch (G_TYPE_FUNDAMENTAL (pspec->value_type)) {
+    case G_TYPE_BOOLEAN:
+      type = G_VARIANT_TYPE_BOOLEAN;
+      break;
+
+    case G_TYPE_INT:
+    case G_TYPE_ENUM:
+      type = G_VARIANT_TYPE_INT32;
+      break;
+
+    case G_TYPE_UINT:
+      type = G_VARIANT_TYPE_UINT32;
+      break;
+
+    case G_TYPE_UINT64:
+      type = G_VARIANT_TYPE_UINT64;
+      break;
+
+    case G_TYPE_STRING:
+      type = G_VARIANT_TYPE_STRING;
+      break;
+
+    case G_TYPE_VARIANT:
+      type = G_PARAM_SPEC_VARIANT (pspec)->type;
+      break;
+
+    default:
+      return FALSE;
+  }
+
+  if (!g_variant_is_of_type (variant, type))
+    return FALSE;
+
+  g_value_init (value, pspec->value_type);
+
+  switch (G_TYPE_FUNDAMENTAL (pspec->value_type)) {
+    case G_TYPE_BOOLEAN:
+      g_value_set_boolean (value, g_variant_get_boolean (variant));
+      break;
+
+    case G_TYPE_INT:
+      g_value_set_int (value, g_variant_get_int32 (variant));
+      break;
+
+    case G_TYPE_ENUM:
+      g_value_set_enum (value, g_variant_get_int32 (variant));
+      break;
+
+    case G_TYPE_UINT:
+      g_value_set_uint (value, g_variant_get_uint32 (variant));
+      break;
+
+    case G_TYPE_UINT64:
+      g_value_set_uint64 (value, g_variant_get_uint64 (variant));
+      break;
+
+    case G_TYPE_STRING:
+      g_value_set_string (value, g_variant_get_string (variant, NULL));
+      break;
+
+    case G_TYPE_VARIANT:
+      g_value_set_variant (value, variant);
+      break;
+  }
+
+  return TRUE;
+}
+
+/* Returns a new reference to the value of the given property as a GVariant,
+ * or NULL if it is not set */
+static GVariant *
+get_property_variant (GstSyncServerInfo * info, GParamSpec * pspec)
+{
+  GValue value = G_VALUE_INIT;
+  GVariant *variant;
+
+  g_value_init (&value, pspec->value_type);
+  g_object_get_property (G_OBJECT (info), pspec->name, &value);
+
+  variant = value_to_variant (&value);
+  if (variant)
+    g_variant_ref_sink (variant);
+
+  g_value_unset (&value);
+
+  return variant;
+}
+
+/* Sets properties from a dictionary of property names to values */
+static gboolean
+set_properties (GstSyncServerInfo * info, GVariant * dict, GError ** err)
+{
+  GObjectClass *klass = G_OBJECT_GET_CLASS (info);
+  GVariant *variant;
+  GVariantIter iter;
+  const gchar *name;
+
+  g_variant_iter_init (&iter, dict);
+  while (g_variant_iter_next (&iter, "{&sv}", &name, &variant)) {
+    GParamSpec *pspec;
+    GValue value = G_VALUE_INIT;
+
+    pspec = g_object_class_find_property (klass, name);
+
+    /* Skip unknown keys, they might be from a newer server */
+    if (!pspec) {
+      g_variant_unref (variant);
+      continue;
+    }
+
+    if (!variant_to_value (variant, pspec, &value)) {
+      g_set_error (err, GST_SYNC_SERVER_INFO_ERROR, 0,
+          "Invalid value for sync info property '%s'", name);
+      g_variant_unref (variant);
+      return FALSE;
+    }
+
+    g_object_set_property (G_OBJECT (info), name, &value);
+
+    g_value_unset (&value);
+    g_variant_unref (variant);
+  }
+
+  return TRUE;
+}
+
+static GBytes *
+variant_to_bytes (GVariant * variant)
+{
+  GBytes *bytes;
+
+  g_variant_ref_sink (variant);
+
+  /* The wire format is always little-endian */
+  if (G_BYTE_ORDER == G_BIG_ENDIAN) {
+    GVariant *swapped = g_variant_byteswap (variant);
+
+    g_variant_unref (variant);
+    variant = swapped;
+  }
+
+  bytes = g_variant_get_data_as_bytes (variant);
+  g_variant_unref (variant);
+
+  return bytes;
+}
+
+static GVariant *
+variant_from_bytes (const GVariantType * type, GBytes * bytes)
+{
+  GVariant *variant;
+
+  /* Not trusted, so GVariant will validate as it deserialises */
+  variant = g_variant_ref_sink (g_variant_new_from_bytes (type, bytes, FALSE));
+
+  if (G_BYTE_ORDER == G_BIG_ENDIAN) {
+    GVariant *swapped = g_variant_byteswap (variant);
+
+    g_variant_unref (variant);
+    variant = swapped;
+  }
+
+  return variant;
+}
+
+static GBytes *
+to_variant_bytes (GstSyncServerInfo * info)
+{
+  GVariantBuilder builder;
+  GParamSpec **pspecs;
+  guint i, n_pspecs;
+
+  pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (info),
+      &n_pspecs);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+  for (i = 0; i < n_pspecs; i++) {
+    GVariant *variant = get_property_variant (info, pspecs[i]);
+
+    if (variant) {
+      g_variant_builder_add (&builder, "{sv}", pspecs[i]->name, variant);
+      g_variant_unref (variant);
+    }
+  }
+
+  g_free (pspecs);
+
+  return variant_to_bytes (g_variant_builder_end (&builder));
+}
+
+static GstSyncServerInfo *
+from_variant_bytes (GBytes * bytes, GError ** err)
+{
+  GstSyncServerInfo *info;
+  GVariant *dict;
+
+  dict = variant_from_bytes (G_VARIANT_TYPE_VARDICT, bytes);
+
+  info = gst_sync_server_info_new ();
+
+  if (!set_properties (info, dict, err))
+    g_clear_object (&info);
+
+  g_variant_unref (dict);
+
+  return info;
+}
+
+static GstSyncServerInfo *
+copy_info (GstSyncServerInfo * info)
+{
+  GstSyncServerInfo *copy;
+  GParamSpec **pspecs;
+  guint i, n_pspecs;
+
+  copy = gst_sync_server_info_new ();
+
+  pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (info),
+      &n_pspecs);
+
+  for (i = 0; i < n_pspecs; i++) {
+    GValue value = G_VALUE_INIT;
+
+    g_value_init (&value, pspecs[i]->value_type);
+    g_object_get_property (G_OBJECT (info), pspecs[i]->name, &value);
+    g_object_set_property (G_OBJECT (copy), pspecs[i]->name, &value);
+    g_value_unset (&value);
+  }
+
+  g_free (pspecs);
+
+  return copy;
+}
+
+/**
+ * gst_sync_server_info_to_bytes:
+ * @info: The #GstSyncServerInfo object
+ *
+ * Serialises @info for sending over the wire, using the encoding selected by
+ * its #GstSyncServerInfo:version property.
+ *
+ * Returns: (transfer full): The serialised sync information.
+ */
+GBytes *
+gst_sync_server_info_to_bytes (GstSyncServerInfo * info)
+{
+  gchar *data;
+  gsize len;
+
+  g_return_val_if_fail (GST_IS_SYNC_SERVER_INFO (info), NULL);
+
+  if (info->version >= GST_SYNC_SERVER_INFO_VERSION_BINARY)
+    return to_variant_bytes (info);
+
+  data = json_gobject_to_data (G_OBJECT (info), &len);
+
+  return g_bytes_new_take (data, len);
+}
+
+/**
+ * gst_sync_server_info_from_bytes:
+ * @bytes: Serialised sync information
+ * @err: A #GError to be set on failure, or %NULL
+ *
+ * Deserialises sync information created by gst_sync_server_info_to_bytes().
+ * Both the JSON and binary encodings are accepted.
+ *
+ * Returns: (transfer full): A new #GstSyncServerInfo, or %NULL if @bytes could
+ *          not be parsed.
+ */
+GstSyncServerInfo *
+gst_sync_server_info_from_bytes (GBytes * bytes, GError ** err)
+{
+  const gchar *data;
+  gsize len;
+
+  g_return_val_if_fail (bytes != NULL, NULL);
+
+  data = g_bytes_get_data (bytes, &len);
+
+  if (len == 0) {
+    g_set_error (err, GST_SYNC_SERVER_INFO_ERROR, 0, "Empty sync info");
+    return NULL;
+  }
+
+  /* A serialised dictionary starts with a property name, so this is
+   * unambiguous */
+  if (data[0] == '{') {
+    return GST_SYNC_SERVER_INFO (json_gobject_from_data
+        (GST_TYPE_SYNC_SERVER_INFO, data, len, err));
+  }
+
+  return from_variant_bytes (bytes, err);
+}
+
 guint64
 gst_sync_server_info_get_version (GstSyncServerInfo * info)
 {
@@ -385,6 +812,24 @@ gst_sync_server_info_get_clock_port (GstSyncServerInfo * info)
   return info->clock_port;
 }
 
+GstSyncServerClockType
+gst_sync_server_info_get_clock_type (GstSyncServerInfo * info)
+{
+  return info->clock_type;
+}
+
+guint
+gst_sync_server_info_get_ptp_domain (GstSyncServerInfo * info)
+{
+  return info->ptp_domain;
+}
+
+guint64
+gst_sync_server_info_get_clock_min_poll_interval (GstSyncServerInfo * info)
+{
+  return info->clock_min_poll_interval;
+}
+
 GVariant *
 gst_sync_server_info_get_playlist (GstSyncServerInfo * info)
 {
@@ -403,6 +848,12 @@ gst_sync_server_info_get_latency (GstSyncServerInfo * info)
   return info->latency;
 }
 
+guint64
+gst_sync_server_info_get_pending_latency (GstSyncServerInfo * info)
+{
+  return info->pending_latency;
+}
+
 gboolean
 gst_sync_server_info_get_stopped (GstSyncServerInfo * info)
 {
@@ -435,3 +886,161 @@ gst_sync_server_info_get_transform (GstSyncServerInfo * info)
   else
     return NULL;
 }
+
+/**
+ * gst_sync_server_info_diff:
+ * @old_info: The #GstSyncServerInfo the receiver already has
+ * @new_info: The updated #GstSyncServerInfo
+ *
+ * Serialises only the differences between @old_info and @new_info, so that a
+ * receiver that has @old_info can reconstruct @new_info using
+ * gst_sync_server_info_patch(). This is usually much smaller than the full
+ * information, since most updates only change a couple of fields.
+ *
+ * Returns: (transfer full): The serialised difference.
+ */
+GBytes *
+gst_sync_server_info_diff (GstSyncServerInfo * old_info,
+    GstSyncServerInfo * new_info)
+{
+  GVariantBuilder changed, unset;
+  GParamSpec **pspecs;
+  guint i, n_pspecs;
+
+  g_return_val_if_fail (GST_IS_SYNC_SERVER_INFO (old_info), NULL);
+  g_return_val_if_fail (GST_IS_SYNC_SERVER_INFO (new_info), NULL);
+
+  pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (new_info),
+      &n_pspecs);
+
+  g_variant_builder_init (&changed, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_init (&unset, G_VARIANT_TYPE_STRING_ARRAY);
+
+  for (i = 0; i < n_pspecs; i++) {
+    GVariant *old_value, *new_value;
+
+    old_value = get_property_variant (old_info, pspecs[i]);
+    new_value = get_property_variant (new_info, pspecs[i]);
+
+    /* Unchanged variant properties are usually the same instance, so check
+     * that before comparing contents */
+    if (new_value && (!old_value || (old_value != new_value &&
+              !g_variant_equal (old_value, new_value))))
+      g_variant_builder_add (&changed, "{sv}", pspecs[i]->name, new_value);
+    else if (!new_value && old_value)
+      g_variant_builder_add (&unset, "s", pspecs[i]->name);
+
+    if (old_value)
+      g_variant_unref (old_value);
+    if (new_value)
+      g_variant_unref (new_value);
+  }
+
+  g_free (pspecs);
+
+  return variant_to_bytes (g_variant_new (DELTA_FORMAT_STRING, &changed,
+        &unset));
+}
+
+/**
+ * gst_sync_server_info_patch:
+ * @info: The #GstSyncServerInfo that @delta was created against
+ * @delta: Serialised differences from gst_sync_server_info_diff()
+ * @err: A #GError to be set on failure, or %NULL
+ *
+ * Applies @delta to a copy of @info. @info itself is not modified.
+ *
+ * Returns: (transfer full): A new #GstSyncServerInfo, or %NULL if @delta could
+ *          not be applied.
+ */
+GstSyncServerInfo *
+gst_sync_server_info_patch (GstSyncServerInfo * info, GBytes * delta,
+    GError ** err)
+{
+  GstSyncServerInfo *patched;
+  GVariant *variant, *changed, *unset;
+  GVariantIter iter;
+  const gchar *name;
+
+  g_return_val_if_fail (GST_IS_SYNC_SERVER_INFO (info), NULL);
+  g_return_val_if_fail (delta != NULL, NULL);
+
+  variant = variant_from_bytes (G_VARIANT_TYPE (DELTA_FORMAT_STRING), delta);
+  changed = g_variant_get_child_value (variant, 0);
+  unset = g_variant_get_child_value (variant, 1);
+
+  patched = copy_info (info);
+
+  if (!set_properties (patched, changed, err)) {
+    g_clear_object (&patched);
+    goto done;
+  }
+
+  g_variant_iter_init (&iter, unset);
+  while (g_variant_iter_next (&iter, "&s", &name)) {
+    GParamSpec *pspec;
+    GValue value = G_VALUE_INIT;
+
+    pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (patched), name);
+    if (!pspec)
+      continue;
+
+    g_value_init (&value, pspec->value_type);
+    g_param_value_set_default (pspec, &value);
+    g_object_set_property (G_OBJECT (patched), name, &value);
+    g_value_unset (&value);
+  }
+
+done:
+  g_variant_unref (changed);
+  g_variant_unref (unset);
+  g_variant_unref (variant);
+
+  return patched;
+}
+
+/**
+ * gst_sync_server_info_filter_transform:
+ * @info: The #GstSyncServerInfo object
+ * @client_id: (nullable): The ID of the client the information is meant for
+ *
+ * Creates a copy of @info whose #GstSyncServerInfo:transform only contains the
+ * entry for @client_id, or is unset if there is no such entry (or @client_id
+ * is %NULL). Clients only ever look up their own transformation, so control
+ * servers can use this to avoid sending every client the transformations for
+ * all clients.
+ *
+ * Returns: (transfer full): A new #GstSyncServerInfo.
+ */
+GstSyncServerInfo *
+gst_sync_server_info_filter_transform (GstSyncServerInfo * info,
+    const gchar * client_id)
+{
+  GstSyncServerInfo *filtered;
+  GVariant *transform = NULL;
+
+  g_return_val_if_fail (GST_IS_SYNC_SERVER_INFO (info), NULL);
+
+  filtered = copy_info (info);
+
+  if (client_id && info->transform) {
+    GVariant *entry;
+
+    entry = g_variant_lookup_value (info->transform, client_id, NULL);
+
+    if (entry) {
+      GVariantBuilder builder;
+
+      g_variant_builder_init (&builder, GST_TYPE_SYNC_SERVER_TRANSFORM);
+      g_variant_builder_add (&builder, "{sv}", client_id, entry);
+      transform = g_variant_builder_end (&builder);
+
+      g_variant_unref (entry);
+    }
+  }
+
+  /* Takes ownership of the floating ref */
+  g_object_set (filtered, "transform", transform, NULL);
+
+  return filtered;
+}
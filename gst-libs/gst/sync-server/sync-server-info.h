@@ -23,19 +23,40 @@
 
 #include <glib.h>
 
+#include "sync-server.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_SYNC_SERVER_INFO (gst_sync_server_info_get_type ())
 G_DECLARE_FINAL_TYPE (GstSyncServerInfo, gst_sync_server_info, GST,
     SYNC_SERVER_INFO, GObject);
 
+/* Sync info versions, these also determine the wire encoding */
+#define GST_SYNC_SERVER_INFO_VERSION_JSON 1
+#define GST_SYNC_SERVER_INFO_VERSION_BINARY 2
+
 GstSyncServerInfo * gst_sync_server_info_new ();
+GBytes *   gst_sync_server_info_to_bytes (GstSyncServerInfo * info);
+GstSyncServerInfo * gst_sync_server_info_from_bytes (GBytes * bytes,
+    GError ** err);
+GBytes *   gst_sync_server_info_diff (GstSyncServerInfo * old_info,
+    GstSyncServerInfo * new_info);
+GstSyncServerInfo * gst_sync_server_info_patch (GstSyncServerInfo * info,
+    GBytes * delta, GError ** err);
+GstSyncServerInfo * gst_sync_server_info_filter_transform (
+    GstSyncServerInfo * info, const gchar * client_id);
 guint64    gst_sync_server_info_get_version (GstSyncServerInfo * info);
 gchar *    gst_sync_server_info_get_clock_address (GstSyncServerInfo * info);
 guint      gst_sync_server_info_get_clock_port (GstSyncServerInfo * info);
+GstSyncServerClockType gst_sync_server_info_get_clock_type (
+    GstSyncServerInfo * info);
+guint      gst_sync_server_info_get_ptp_domain (GstSyncServerInfo * info);
+guint64    gst_sync_server_info_get_clock_min_poll_interval (
+    GstSyncServerInfo * info);
 GVariant * gst_sync_server_info_get_playlist (GstSyncServerInfo * info);
 guint64    gst_sync_server_info_get_base_time (GstSyncServerInfo * info);
 guint64    gst_sync_server_info_get_latency (GstSyncServerInfo * info);
+guint64    gst_sync_server_info_get_pending_latency (GstSyncServerInfo * info);
 gboolean   gst_sync_server_info_get_stopped (GstSyncServerInfo * info);
 gboolean   gst_sync_server_info_get_paused (GstSyncServerInfo * info);
 guint64    gst_sync_server_info_get_base_time_offset (GstSyncServerInfo * info);
@@ -50,6 +50,7 @@
 #include "sync-server-info.h"
 #include "sync-control-server.h"
 #include "sync-control-tcp-server.h"
+#include "sync-time-server.h"
 
 struct _GstSyncServer {
   GObject parent;
@@ -57,12 +58,24 @@ struct _GstSyncServer {
   gchar *control_addr;
   gint control_port;
   gint clock_port;
+  GstSyncServerClockType clock_type;
+  guint ptp_domain;
+  gchar *ntp_addr;
+  gint ntp_port;
+  guint time_server_threads;
+  guint clock_poll_budget;
+  guint64 clock_min_poll_interval;
+  gint n_clients; /* atomic, updated from the control server's threads */
   guint64 latency;
+  gboolean auto_latency;
+  guint64 latency_margin;
+  guint64 pending_latency; /* takes effect at the next track, 0 if none */
   guint64 base_time; /* time of first transition to PLAYING */
   guint64 base_time_offset; /* what to offset base time by */
   guint64 stream_start_delay;
   guint64 last_pause_time;
   guint64 last_duration;
+  guint64 sync_info_version;
 
   gchar **uris;
   guint64 *durations;
@@ -75,11 +88,25 @@ struct _GstSyncServer {
   gboolean stopped;
   gboolean paused;
   GstElement *pipeline;
+  /* The track after the current one is opened and prerolled in here, and
+   * the two are swapped when we move to it */
+  GstElement *next_pipeline;
+  gchar *next_uri; /* what next_pipeline has prerolled, NULL if nothing */
+
+  /* Follow tracks with known durations on the clock rather than playing
+   * them */
+  gboolean timeline_only;
+  GstClockID track_end_id;
+  GstClockTime track_end_time;
 
   GstNetTimeProvider *clock_provider;
+  GstSyncTimeServer *time_server;
   GstClock *clock;
 
   GstSyncControlServer *server;
+
+  GHashTable *client_stats; /* client id -> a{sv} */
+  GMutex stats_lock;
 };
 
 struct _GstSyncServerClass {
@@ -104,11 +131,38 @@ enum {
   PROP_LATENCY,
   PROP_STREAM_START_DELAY,
   PROP_TRANSFORM,
+  PROP_SYNC_INFO_VERSION,
+  PROP_CLOCK_TYPE,
+  PROP_PTP_DOMAIN,
+  PROP_NTP_ADDRESS,
+  PROP_NTP_PORT,
+  PROP_CLIENT_STATS,
+  PROP_TIME_SERVER_THREADS,
+  PROP_CLOCK_POLL_BUDGET,
+  PROP_AUTO_LATENCY,
+  PROP_LATENCY_MARGIN,
+  PROP_TIMELINE_ONLY,
 };
 
 #define DEFAULT_PORT 0
 #define DEFAULT_LATENCY (300 * GST_MSECOND)
 #define DEFAULT_STREAM_START_DELAY (500 * GST_MSECOND)
+#define DEFAULT_SYNC_INFO_VERSION GST_SYNC_SERVER_INFO_VERSION_JSON
+#define DEFAULT_CLOCK_TYPE GST_SYNC_SERVER_CLOCK_TYPE_NET
+#define DEFAULT_PTP_DOMAIN 0
+#define DEFAULT_NTP_PORT 123
+#define DEFAULT_TIME_SERVER_THREADS 0
+#define DEFAULT_CLOCK_POLL_BUDGET 0
+#define DEFAULT_AUTO_LATENCY FALSE
+#define DEFAULT_LATENCY_MARGIN (50 * GST_MSECOND)
+#define DEFAULT_TIMELINE_ONLY FALSE
+
+/* Automatic latency is rounded up to this, so that small variations in what
+ * clients measure don't cause a stream of updates */
+#define LATENCY_GRANULARITY (10 * GST_MSECOND)
+
+/* How long to wait for a PTP/NTP clock to synchronise when starting */
+#define CLOCK_SYNC_TIMEOUT (10 * GST_SECOND)
 
 static void
 free_playlist (GstSyncServer * self)
@@ -122,20 +176,39 @@ free_playlist (GstSyncServer * self)
   self->durations = NULL;
 }
 
+static void stop_track_timer (GstSyncServer * self);
+
 static void
 gst_sync_server_cleanup (GstSyncServer * self)
 {
+  stop_track_timer (self);
+
   if (self->clock_provider) {
     g_object_unref (self->clock_provider);
     self->clock_provider = NULL;
   }
 
+  if (self->time_server) {
+    gst_sync_time_server_stop (self->time_server);
+    g_object_unref (self->time_server);
+    self->time_server = NULL;
+  }
+
   if (self->pipeline) {
     gst_element_set_state (self->pipeline, GST_STATE_NULL);
     gst_object_unref (self->pipeline);
     self->pipeline = NULL;
   }
 
+  if (self->next_pipeline) {
+    gst_element_set_state (self->next_pipeline, GST_STATE_NULL);
+    gst_object_unref (self->next_pipeline);
+    self->next_pipeline = NULL;
+  }
+
+  g_free (self->next_uri);
+  self->next_uri = NULL;
+
   if (self->server) {
     gst_sync_control_server_stop (self->server);
     g_object_unref (self->server);
@@ -153,6 +226,7 @@ gst_sync_server_dispose (GObject * object)
     gst_sync_server_stop (self);
 
   g_free (self->control_addr);
+  g_free (self->ntp_addr);
 
   free_playlist (self);
 
@@ -169,9 +243,134 @@ gst_sync_server_dispose (GObject * object)
   if (self->clock)
     gst_object_unref (self->clock);
 
+  if (self->client_stats) {
+    g_hash_table_unref (self->client_stats);
+    self->client_stats = NULL;
+  }
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
+static void
+gst_sync_server_finalize (GObject * object)
+{
+  GstSyncServer *self = GST_SYNC_SERVER (object);
+
+  g_mutex_clear (&self->stats_lock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static GstSyncServerInfo * get_sync_info (GstSyncServer * self);
+static void end_of_track (GstSyncServer * self);
+
+/* Whether we follow this track on the clock alone, without playing it. The
+ * playlist can mark unknown durations with 0 as well, and we must play those
+ * to find out when they end. */
+static gboolean
+is_timed_track (GstSyncServer * self, guint64 track)
+{
+  return self->timeline_only && track < self->n_tracks &&
+    self->durations[track] != GST_CLOCK_TIME_NONE &&
+    self->durations[track] != 0;
+}
+
+static void
+push_sync_info (GstSyncServer * self)
+{
+  GstSyncServerInfo *info;
+
+  info = get_sync_info (self);
+  gst_sync_control_server_set_sync_info (self->server, info);
+  g_object_unref (info);
+}
+
+static void
+stop_track_timer (GstSyncServer * self)
+{
+  if (self->track_end_id) {
+    gst_clock_id_unschedule (self->track_end_id);
+    gst_clock_id_unref (self->track_end_id);
+    self->track_end_id = NULL;
+  }
+}
+
+static gboolean
+track_end_idle (gpointer user_data)
+{
+  GstSyncServer *self = GST_SYNC_SERVER (user_data);
+
+  /* We might have paused or moved on since the timer fired */
+  if (self->track_end_id &&
+      gst_clock_get_time (self->clock) >= self->track_end_time) {
+    stop_track_timer (self);
+    end_of_track (self);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+track_end_cb (GstClock * clock, GstClockTime time, GstClockID id,
+    gpointer user_data)
+{
+  GstSyncServer *self = GST_SYNC_SERVER (user_data);
+
+  /* We're on the clock's thread here */
+  g_idle_add_full (G_PRIORITY_DEFAULT, track_end_idle, g_object_ref (self),
+      g_object_unref);
+
+  return TRUE;
+}
+
+/* Waits for the current (timed) track to end on the clock */
+static void
+start_track_timer (GstSyncServer * self)
+{
+  stop_track_timer (self);
+
+  self->track_end_time = self->base_time + self->base_time_offset +
+    self->durations[self->current_track];
+
+  GST_DEBUG_OBJECT (self, "Track %lu ends at %" GST_TIME_FORMAT,
+      self->current_track, GST_TIME_ARGS (self->track_end_time));
+
+  self->track_end_id =
+    gst_clock_new_single_shot_id (self->clock, self->track_end_time);
+  gst_clock_id_wait_async (self->track_end_id, track_end_cb, self, NULL);
+}
+
+/* Opens and prerolls the track after the current one, so that moving to it
+ * when the current one ends is just a state change */
+static void
+prepare_next_track (GstSyncServer * self)
+{
+  const gchar *uri;
+
+  g_free (self->next_uri);
+  self->next_uri = NULL;
+
+  gst_element_set_state (self->next_pipeline, GST_STATE_READY);
+
+  if (self->stopped || self->current_track == -1 ||
+      self->current_track + 1 >= self->n_tracks ||
+      is_timed_track (self, self->current_track + 1))
+    return;
+
+  uri = self->uris[self->current_track + 1];
+  gst_child_proxy_set (GST_CHILD_PROXY (self->next_pipeline),
+      "uridecodebin::uri", uri, NULL);
+
+  if (gst_element_set_state (self->next_pipeline, GST_STATE_PAUSED) ==
+      GST_STATE_CHANGE_FAILURE) {
+    GST_WARNING_OBJECT (self, "Could not prepare next URI: %s", uri);
+    gst_element_set_state (self->next_pipeline, GST_STATE_READY);
+    return;
+  }
+
+  self->next_uri = g_strdup (uri);
+}
+
 static gboolean
 update_pipeline (GstSyncServer * self, gboolean advance)
 {
@@ -198,8 +397,59 @@ update_pipeline (GstSyncServer * self, gboolean advance)
     self->current_track++;
   }
 
-  gst_child_proxy_set (GST_CHILD_PROXY (self->pipeline), "uridecodebin::uri",
-      self->uris[self->current_track], NULL);
+  if (self->pending_latency) {
+    GST_INFO_OBJECT (self, "Switching latency to %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (self->pending_latency));
+
+    self->latency = self->pending_latency;
+    self->pending_latency = 0;
+    g_object_notify (G_OBJECT (self), "latency");
+  }
+
+  stop_track_timer (self);
+
+  if (is_timed_track (self, self->current_track)) {
+    /* There's nothing to play, we just need to know when the track ends */
+    gst_element_set_state (self->pipeline, GST_STATE_READY);
+
+    if (!self->stopped && !self->paused) {
+      if (!advance) {
+        self->base_time = gst_clock_get_time (self->clock);
+        self->base_time_offset = 0;
+      }
+
+      start_track_timer (self);
+    }
+
+    /* Without a pipeline changing state, this is the time to do this */
+    push_sync_info (self);
+    prepare_next_track (self);
+
+    return TRUE;
+  }
+
+  if (advance && self->next_uri &&
+      g_str_equal (self->next_uri, self->uris[self->current_track])) {
+    GstElement *pipeline;
+
+    /* We've already got this one open, so switch to it. The old pipeline is
+     * where we'll open the track after this one. */
+    GST_DEBUG_OBJECT (self, "Switching to prepared track %lu",
+        self->current_track);
+
+    pipeline = self->pipeline;
+    self->pipeline = self->next_pipeline;
+    self->next_pipeline = pipeline;
+
+    g_free (self->next_uri);
+    self->next_uri = NULL;
+  } else {
+    if (advance)
+      gst_element_set_state (self->pipeline, GST_STATE_READY);
+
+    gst_child_proxy_set (GST_CHILD_PROXY (self->pipeline),
+        "uridecodebin::uri", self->uris[self->current_track], NULL);
+  }
 
   gst_pipeline_set_latency (GST_PIPELINE (self->pipeline),
       self->latency);
@@ -229,13 +479,39 @@ update_pipeline (GstSyncServer * self, gboolean advance)
     return FALSE;
   }
 
+  prepare_next_track (self);
+
   return TRUE;
 }
 
+/* The current track is done, because its pipeline reached EOS or its time
+ * is up */
+static void
+end_of_track (GstSyncServer * self)
+{
+  gboolean last_track = self->current_track + 1 == self->n_tracks;
+
+  /* Otherwise, the next track should be prerolled and waiting (or not need
+   * playing at all), and update_pipeline() will switch to it */
+  if (last_track)
+    gst_element_set_state (self->pipeline, GST_STATE_NULL);
+
+  g_signal_emit_by_name (self, "end-of-stream");
+
+  if (last_track) {
+    self->current_track = -1;
+    g_signal_emit_by_name (self, "end-of-playlist");
+  } else {
+    /* Go to the next track */
+    update_pipeline (self, TRUE);
+  }
+}
+
 static GstSyncServerInfo *
 get_sync_info (GstSyncServer * self)
 {
   GstSyncServerInfo *info;
+  const gchar *clock_addr;
   guint clock_port;
   GVariant *playlist;
 
@@ -244,15 +520,36 @@ get_sync_info (GstSyncServer * self)
   playlist = gst_sync_server_playlist_new (self->uris, self->durations,
       self->n_tracks, self->current_track);
 
-  g_object_get (self->clock_provider, "port", &clock_port, NULL);
+  switch (self->clock_type) {
+    case GST_SYNC_SERVER_CLOCK_TYPE_NET:
+      clock_addr = self->control_addr;
+      clock_port = self->clock_port;
+      break;
+
+    case GST_SYNC_SERVER_CLOCK_TYPE_NTP:
+      clock_addr = self->ntp_addr;
+      clock_port = self->ntp_port;
+      break;
+
+    default:
+      /* PTP finds its own way */
+      clock_addr = NULL;
+      clock_port = 0;
+      break;
+  }
 
   g_object_set (info,
-      "clock-address", self->control_addr,
+      "version", self->sync_info_version,
+      "clock-type", self->clock_type,
+      "clock-address", clock_addr,
       "clock-port", clock_port,
+      "ptp-domain", self->ptp_domain,
+      "clock-min-poll-interval", self->clock_min_poll_interval,
       "playlist", playlist, /* Takes ownership of the floating ref */
       "base-time", self->base_time,
       "base-time-offset", self->base_time_offset,
       "latency", self->latency,
+      "pending-latency", self->pending_latency,
       "stream-start-delay", self->stream_start_delay,
       "stopped", self->stopped,
       "paused", self->paused, /* FIXME: Deal with pausing on live streams */
@@ -262,12 +559,127 @@ get_sync_info (GstSyncServer * self)
   return info;
 }
 
+/* Spread the polling budget over the clients we have. The interval is
+ * rounded up to a power of two milliseconds, so that clients coming and going
+ * don't make us send out new sync info every time. */
+static void
+update_clock_min_poll_interval (GstSyncServer * self)
+{
+  guint64 interval = 0, ms;
+  guint n_clients;
+
+  n_clients = g_atomic_int_get (&self->n_clients);
+
+  if (self->clock_poll_budget > 0 && n_clients > 0) {
+    ms = (n_clients * 1000 + self->clock_poll_budget - 1) /
+      self->clock_poll_budget;
+
+    interval = 1;
+    while (interval < ms)
+      interval <<= 1;
+
+    interval *= GST_MSECOND;
+  }
+
+  if (interval == self->clock_min_poll_interval)
+    return;
+
+  GST_DEBUG_OBJECT (self, "Clock min poll interval for %u clients is now %"
+      GST_TIME_FORMAT, n_clients, GST_TIME_ARGS (interval));
+
+  self->clock_min_poll_interval = interval;
+
+  if (self->server_started) {
+    GstSyncServerInfo *info;
+
+    info = get_sync_info (self);
+    gst_sync_control_server_set_sync_info (self->server, info);
+    g_object_unref (info);
+  }
+}
+
+static gboolean
+update_clock_min_poll_interval_idle (gpointer user_data)
+{
+  update_clock_min_poll_interval (GST_SYNC_SERVER (user_data));
+
+  return G_SOURCE_REMOVE;
+}
+
+/* The smallest latency that works for every client that has told us what it
+ * needs, or 0 if none have */
+static guint64
+get_auto_latency (GstSyncServer * self)
+{
+  GHashTableIter iter;
+  gpointer stats;
+  guint64 latency, max_latency = 0;
+
+  g_mutex_lock (&self->stats_lock);
+
+  g_hash_table_iter_init (&iter, self->client_stats);
+  while (g_hash_table_iter_next (&iter, NULL, &stats)) {
+    if (g_variant_lookup (stats, "latency", "t", &latency))
+      max_latency = MAX (max_latency, latency);
+  }
+
+  g_mutex_unlock (&self->stats_lock);
+
+  if (max_latency == 0)
+    return 0;
+
+  latency = max_latency + self->latency_margin;
+
+  return (latency + LATENCY_GRANULARITY - 1) / LATENCY_GRANULARITY *
+    LATENCY_GRANULARITY;
+}
+
+/* We don't change the latency under clients' feet, but announce it so that
+ * everyone switches at the next track together */
+static gboolean
+update_auto_latency_idle (gpointer user_data)
+{
+  GstSyncServer *self = GST_SYNC_SERVER (user_data);
+  guint64 latency, pending;
+
+  latency = get_auto_latency (self);
+  if (latency == 0)
+    return G_SOURCE_REMOVE;
+
+  pending = latency == self->latency ? 0 : latency;
+  if (pending == self->pending_latency)
+    return G_SOURCE_REMOVE;
+
+  GST_INFO_OBJECT (self, "Latency will be %" GST_TIME_FORMAT
+      " from the next track", GST_TIME_ARGS (latency));
+
+  self->pending_latency = pending;
+
+  if (self->server_started) {
+    GstSyncServerInfo *info;
+
+    info = get_sync_info (self);
+    gst_sync_control_server_set_sync_info (self->server, info);
+    g_object_unref (info);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 client_joined_cb (GstSyncControlServer * server, const gchar * id,
     const GVariant * config, gpointer user_data)
 {
   GstSyncServer *self = GST_SYNC_SERVER (user_data);
 
+  g_atomic_int_inc (&self->n_clients);
+
+  /* We might be on one of the control server's threads */
+  if (self->clock_poll_budget > 0) {
+    g_idle_add_full (G_PRIORITY_DEFAULT, update_clock_min_poll_interval_idle,
+        g_object_ref (self), g_object_unref);
+  }
+
   g_signal_emit_by_name (self, "client-joined", id, config);
 }
 
@@ -277,9 +689,75 @@ client_left_cb (GstSyncControlServer * server, const gchar * id,
 {
   GstSyncServer *self = GST_SYNC_SERVER (user_data);
 
+  g_mutex_lock (&self->stats_lock);
+  g_hash_table_remove (self->client_stats, id);
+  g_mutex_unlock (&self->stats_lock);
+
+  g_atomic_int_add (&self->n_clients, -1);
+
+  if (self->clock_poll_budget > 0) {
+    g_idle_add_full (G_PRIORITY_DEFAULT, update_clock_min_poll_interval_idle,
+        g_object_ref (self), g_object_unref);
+  }
+
+  /* The client that left may have been the one that needed the most */
+  if (self->auto_latency) {
+    g_idle_add_full (G_PRIORITY_DEFAULT, update_auto_latency_idle,
+        g_object_ref (self), g_object_unref);
+  }
+
   g_signal_emit_by_name (self, "client-left", id);
 }
 
+static void
+client_stats_cb (GstSyncControlServer * server, const gchar * id,
+    GVariant * stats, gpointer user_data)
+{
+  GstSyncServer *self = GST_SYNC_SERVER (user_data);
+  GVariant *old_stats;
+  guint64 latency = 0, old_latency = 0;
+
+  g_mutex_lock (&self->stats_lock);
+
+  old_stats = g_hash_table_lookup (self->client_stats, id);
+  if (old_stats)
+    g_variant_lookup (old_stats, "latency", "t", &old_latency);
+
+  g_hash_table_insert (self->client_stats, g_strdup (id),
+      g_variant_ref (stats));
+
+  g_mutex_unlock (&self->stats_lock);
+
+  /* Clients keep reporting the same latency, only look again if it changed */
+  g_variant_lookup (stats, "latency", "t", &latency);
+  if (self->auto_latency && latency != old_latency) {
+    g_idle_add_full (G_PRIORITY_DEFAULT, update_auto_latency_idle,
+        g_object_ref (self), g_object_unref);
+  }
+
+  g_signal_emit_by_name (self, "client-stats", id, stats);
+}
+
+static GVariant *
+get_client_stats (GstSyncServer * self)
+{
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  gpointer id, stats;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+
+  g_mutex_lock (&self->stats_lock);
+
+  g_hash_table_iter_init (&iter, self->client_stats);
+  while (g_hash_table_iter_next (&iter, &id, &stats))
+    g_variant_builder_add (&builder, "{sv}", id, stats);
+
+  g_mutex_unlock (&self->stats_lock);
+
+  return g_variant_builder_end (&builder);
+}
+
 static void
 gst_sync_server_set_property (GObject * object, guint property_id,
     const GValue * value, GParamSpec * pspec)
@@ -298,6 +776,8 @@ gst_sync_server_set_property (GObject * object, guint property_id,
           G_CALLBACK (client_joined_cb), self);
       g_signal_connect (self->server, "client-left",
           G_CALLBACK (client_left_cb), self);
+      g_signal_connect (self->server, "client-stats",
+          G_CALLBACK (client_stats_cb), self);
 
       break;
 
@@ -344,6 +824,9 @@ gst_sync_server_set_property (GObject * object, guint property_id,
           gst_sync_control_server_set_sync_info (self->server,
               get_sync_info (self));
           g_object_unref (info);
+
+          /* The next track might be a different one now */
+          prepare_next_track (self);
         }
       }
 
@@ -369,6 +852,48 @@ gst_sync_server_set_property (GObject * object, guint property_id,
       self->transform = g_value_dup_variant (value);
       break;
 
+    case PROP_SYNC_INFO_VERSION:
+      self->sync_info_version = g_value_get_uint64 (value);
+      break;
+
+    case PROP_CLOCK_TYPE:
+      self->clock_type = g_value_get_enum (value);
+      break;
+
+    case PROP_PTP_DOMAIN:
+      self->ptp_domain = g_value_get_uint (value);
+      break;
+
+    case PROP_NTP_ADDRESS:
+      g_free (self->ntp_addr);
+      self->ntp_addr = g_value_dup_string (value);
+      break;
+
+    case PROP_NTP_PORT:
+      self->ntp_port = g_value_get_int (value);
+      break;
+
+    case PROP_TIME_SERVER_THREADS:
+      self->time_server_threads = g_value_get_uint (value);
+      break;
+
+    case PROP_CLOCK_POLL_BUDGET:
+      self->clock_poll_budget = g_value_get_uint (value);
+      update_clock_min_poll_interval (self);
+      break;
+
+    case PROP_AUTO_LATENCY:
+      self->auto_latency = g_value_get_boolean (value);
+      break;
+
+    case PROP_LATENCY_MARGIN:
+      self->latency_margin = g_value_get_uint64 (value);
+      break;
+
+    case PROP_TIMELINE_ONLY:
+      self->timeline_only = g_value_get_boolean (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -411,6 +936,50 @@ gst_sync_server_get_property (GObject * object, guint property_id,
       g_value_set_variant (value, self->transform);
       break;
 
+    case PROP_SYNC_INFO_VERSION:
+      g_value_set_uint64 (value, self->sync_info_version);
+      break;
+
+    case PROP_CLOCK_TYPE:
+      g_value_set_enum (value, self->clock_type);
+      break;
+
+    case PROP_PTP_DOMAIN:
+      g_value_set_uint (value, self->ptp_domain);
+      break;
+
+    case PROP_NTP_ADDRESS:
+      g_value_set_string (value, self->ntp_addr);
+      break;
+
+    case PROP_NTP_PORT:
+      g_value_set_int (value, self->ntp_port);
+      break;
+
+    case PROP_CLIENT_STATS:
+      g_value_take_variant (value, get_client_stats (self));
+      break;
+
+    case PROP_TIME_SERVER_THREADS:
+      g_value_set_uint (value, self->time_server_threads);
+      break;
+
+    case PROP_CLOCK_POLL_BUDGET:
+      g_value_set_uint (value, self->clock_poll_budget);
+      break;
+
+    case PROP_AUTO_LATENCY:
+      g_value_set_boolean (value, self->auto_latency);
+      break;
+
+    case PROP_LATENCY_MARGIN:
+      g_value_set_uint64 (value, self->latency_margin);
+      break;
+
+    case PROP_TIMELINE_ONLY:
+      g_value_set_boolean (value, self->timeline_only);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -423,6 +992,7 @@ gst_sync_server_class_init (GstSyncServerClass * klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
   object_class->dispose = GST_DEBUG_FUNCPTR (gst_sync_server_dispose);
+  object_class->finalize = GST_DEBUG_FUNCPTR (gst_sync_server_finalize);
   object_class->set_property =
     GST_DEBUG_FUNCPTR (gst_sync_server_set_property);
   object_class->get_property =
@@ -481,7 +1051,8 @@ gst_sync_server_class_init (GstSyncServerClass * klass)
    *
    * The pipeline latency that clients should use. This should be large enough
    * to account for any buffering that is expected (network related for
-   * HTTP/RTP/... streams, and worst-case audio device latency).
+   * HTTP/RTP/... streams, and worst-case audio device latency). With
+   * #GstSyncServer:auto-latency, this is only the starting value.
    */
   g_object_class_install_property (object_class, PROP_LATENCY,
       g_param_spec_uint64 ("latency", "Latency",
@@ -495,6 +1066,10 @@ gst_sync_server_class_init (GstSyncServerClass * klass)
    * for devices which take different amounts of time to load the data (either
    * due to network delays or differing storage speeds) to start smoothly at
    * the same time when switching streams.
+   *
+   * Set this to 0 for gapless playback. Clients then queue up the next track
+   * before the current one ends, instead of reloading their pipelines in the
+   * gap.
    */
   g_object_class_install_property (object_class, PROP_STREAM_START_DELAY,
       g_param_spec_uint64 ("stream-start-delay", "Stream start delay",
@@ -520,6 +1095,8 @@ gst_sync_server_class_init (GstSyncServerClass * klass)
    *   (gint32)
    * - "rotate": An integer value from the #GstVideoOrientationMethod enum.
    *   (guint32)
+   *
+   * The default control server only sends each client its own entry.
    */
   g_object_class_install_property (object_class, PROP_TRANSFORM,
       g_param_spec_variant ("transform", "Transformation",
@@ -527,6 +1104,161 @@ gst_sync_server_class_init (GstSyncServerClass * klass)
         GST_TYPE_SYNC_SERVER_TRANSFORM, NULL,
         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstSyncServer:sync-info-version:
+   *
+   * The version of the sync information sent to clients, which also selects
+   * its wire encoding. Version 1 is JSON, which all clients understand.
+   * Version 2 is a compact binary encoding that is much cheaper for clients to
+   * decode, but requires clients that support it.
+   */
+  g_object_class_install_property (object_class, PROP_SYNC_INFO_VERSION,
+      g_param_spec_uint64 ("sync-info-version", "Sync info version",
+        "Version (and encoding) of sync information sent to clients",
+        GST_SYNC_SERVER_INFO_VERSION_JSON,
+        GST_SYNC_SERVER_INFO_VERSION_BINARY, DEFAULT_SYNC_INFO_VERSION,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncServer:clock-type:
+   *
+   * The clock that the server and clients synchronise against. By default, the
+   * server provides its system clock over the network. On networks that
+   * already have PTP or NTP infrastructure, that can be used instead, which
+   * avoids running a second clock protocol. This must be set before the
+   * server is started.
+   */
+  g_object_class_install_property (object_class, PROP_CLOCK_TYPE,
+      g_param_spec_enum ("clock-type", "Clock type",
+        "Type of clock to synchronise against",
+        GST_TYPE_SYNC_SERVER_CLOCK_TYPE, DEFAULT_CLOCK_TYPE,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncServer:ptp-domain:
+   *
+   * The PTP domain to use if #GstSyncServer:clock-type is
+   * #GST_SYNC_SERVER_CLOCK_TYPE_PTP.
+   */
+  g_object_class_install_property (object_class, PROP_PTP_DOMAIN,
+      g_param_spec_uint ("ptp-domain", "PTP domain",
+        "PTP domain for the PTP clock type", 0, 255, DEFAULT_PTP_DOMAIN,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncServer:ntp-address:
+   *
+   * The address of the NTP server to use if #GstSyncServer:clock-type is
+   * #GST_SYNC_SERVER_CLOCK_TYPE_NTP. Clients use the same server, so this
+   * must be reachable from them too.
+   */
+  g_object_class_install_property (object_class, PROP_NTP_ADDRESS,
+      g_param_spec_string ("ntp-address", "NTP address",
+        "Address of the NTP server for the NTP clock type", NULL,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncServer:ntp-port:
+   *
+   * The port of the NTP server to use if #GstSyncServer:clock-type is
+   * #GST_SYNC_SERVER_CLOCK_TYPE_NTP.
+   */
+  g_object_class_install_property (object_class, PROP_NTP_PORT,
+      g_param_spec_int ("ntp-port", "NTP port",
+        "Port of the NTP server for the NTP clock type", 1, 65535,
+        DEFAULT_NTP_PORT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncServer:client-stats:
+   *
+   * The most recent clock statistics reported by each connected client, as
+   * a dictionary of client ID to a dictionary of statistics. See
+   * #GstSyncClient:clock-stats for the keys in each client's statistics.
+   */
+  g_object_class_install_property (object_class, PROP_CLIENT_STATS,
+      g_param_spec_variant ("client-stats", "Client statistics",
+        "Clock statistics reported by clients", G_VARIANT_TYPE_VARDICT, NULL,
+        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncServer:time-server-threads:
+   *
+   * If non-zero, and #GstSyncServer:clock-type is
+   * #GST_SYNC_SERVER_CLOCK_TYPE_NET, the clock is provided by a built-in time
+   * server using this many threads instead of a #GstNetTimeProvider. The
+   * built-in server speaks the same protocol, but handles requests in batches
+   * and can spread the load over several threads, which helps when there are
+   * many clients. Where the platform supports it, it also uses kernel receive
+   * timestamps, so the server's own scheduling latency does not add to the
+   * clients' clock error. This must be set before the server is started.
+   */
+  g_object_class_install_property (object_class, PROP_TIME_SERVER_THREADS,
+      g_param_spec_uint ("time-server-threads", "Time server threads",
+        "Threads for the built-in time server (0 = use GstNetTimeProvider)",
+        0, G_MAXUINT, DEFAULT_TIME_SERVER_THREADS,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncServer:clock-poll-budget
+   *
+   * The number of clock requests per second that the time provider should
+   * have to answer across all clients. This is divided among the connected
+   * clients and advertised as #GstSyncServerInfo:clock-min-poll-interval, and
+   * clients will not poll faster than that even when they are converging.
+   * With the default of 0, adaptive polling only ever slows clients down from
+   * their clock's default interval (see #GstSyncClient:adaptive-poll).
+   */
+  g_object_class_install_property (object_class, PROP_CLOCK_POLL_BUDGET,
+      g_param_spec_uint ("clock-poll-budget", "Clock poll budget",
+        "Clock requests per second across all clients (0 = unlimited)",
+        0, G_MAXUINT, DEFAULT_CLOCK_POLL_BUDGET,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncServer:auto-latency:
+   *
+   * If set, clients' measured latencies (how long they took to preroll, plus
+   * what their pipeline reports) are used to pick the smallest latency that
+   * works for all of them, plus #GstSyncServer:latency-margin. The new latency
+   * takes effect at the next track, and #GstSyncServer:latency is updated
+   * then. Clients need to have statistics reporting enabled (see
+   * #GstSyncClient:stats-interval).
+   */
+  g_object_class_install_property (object_class, PROP_AUTO_LATENCY,
+      g_param_spec_boolean ("auto-latency", "Auto latency",
+        "Pick the latency based on what clients measure",
+        DEFAULT_AUTO_LATENCY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncServer:latency-margin:
+   *
+   * With #GstSyncServer:auto-latency, how much latency (in nanoseconds) to
+   * add on top of what the slowest client needs, to account for variations
+   * and for getting the sync information to clients.
+   */
+  g_object_class_install_property (object_class, PROP_LATENCY_MARGIN,
+      g_param_spec_uint64 ("latency-margin", "Latency margin",
+        "Latency to add to what clients need with auto-latency (ns)", 0,
+        G_MAXUINT64, DEFAULT_LATENCY_MARGIN,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSyncServer:timeline-only:
+   *
+   * Normally, the server plays each track itself (without decoding it) to
+   * find out when it ends. If this is set, tracks with a duration in the
+   * playlist are not opened at all, and the timeline moves on when that
+   * duration has passed on the clock. This saves the server fetching and
+   * demuxing every stream, but relies on the durations being accurate.
+   * Tracks without a duration (0 or %GST_CLOCK_TIME_NONE) are still played.
+   * Takes effect from the next track.
+   */
+  g_object_class_install_property (object_class, PROP_TIMELINE_ONLY,
+      g_param_spec_boolean ("timeline-only", "Timeline only",
+        "Follow tracks with known durations on the clock without playing "
+        "them", DEFAULT_TIMELINE_ONLY,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstSyncServer::end-of-stream
    *
@@ -570,6 +1302,20 @@ gst_sync_server_class_init (GstSyncServerClass * klass)
   g_signal_new_class_handler ("client-left", GST_TYPE_SYNC_SERVER,
       G_SIGNAL_RUN_LAST, NULL, NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_STRING,
       NULL);
+
+  /**
+   * GstSyncServer::client-stats:
+   * @server: the #GstSyncServer
+   * @id: (transfer none): the client ID as a string
+   * @stats: (transfer none): the client's clock statistics as a #GVariant
+   *         dictionary
+   *
+   * Emitted whenever a client reports its clock statistics. This might be
+   * emitted from any thread.
+   */
+  g_signal_new_class_handler ("client-stats", GST_TYPE_SYNC_SERVER,
+      G_SIGNAL_RUN_LAST, NULL, NULL, NULL, NULL, G_TYPE_NONE, 2, G_TYPE_STRING,
+      G_TYPE_VARIANT, NULL);
 }
 
 static void
@@ -583,15 +1329,37 @@ gst_sync_server_init (GstSyncServer * self)
   self->uris = NULL;
   self->durations = NULL;
   self->latency = DEFAULT_LATENCY;
+  self->auto_latency = DEFAULT_AUTO_LATENCY;
+  self->latency_margin = DEFAULT_LATENCY_MARGIN;
+  self->timeline_only = DEFAULT_TIMELINE_ONLY;
+  self->track_end_id = NULL;
+  self->track_end_time = GST_CLOCK_TIME_NONE;
+  self->pending_latency = 0;
   self->stream_start_delay = DEFAULT_STREAM_START_DELAY;
+  self->sync_info_version = DEFAULT_SYNC_INFO_VERSION;
+  self->clock_type = DEFAULT_CLOCK_TYPE;
+  self->ptp_domain = DEFAULT_PTP_DOMAIN;
+  self->ntp_addr = NULL;
+  self->ntp_port = DEFAULT_NTP_PORT;
+  self->time_server_threads = DEFAULT_TIME_SERVER_THREADS;
+  self->clock_poll_budget = DEFAULT_CLOCK_POLL_BUDGET;
+  self->clock_min_poll_interval = 0;
+  self->n_clients = 0;
   self->server_started = FALSE;
   self->paused = FALSE;
   self->base_time_offset = 0;
   self->last_pause_time = GST_CLOCK_TIME_NONE;
 
   self->server = NULL;
+  self->pipeline = NULL;
+  self->next_pipeline = NULL;
+  self->next_uri = NULL;
 
   self->fakesinks = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  self->client_stats = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) g_variant_unref);
+  g_mutex_init (&self->stats_lock);
 }
 
 /**
@@ -620,6 +1388,8 @@ pad_added_cb (GstElement * bin, GstPad * pad, gpointer user_data)
   GstSyncServer *self = GST_SYNC_SERVER (user_data);
   GstElement *fakesink;
   GstPad *sinkpad;
+  /* This might be either of our pipelines */
+  GstBin *pipeline = GST_BIN (GST_ELEMENT_PARENT (bin));
 
   fakesink = gst_element_factory_make ("fakesink", NULL);
   g_assert (fakesink != NULL);
@@ -628,7 +1398,7 @@ pad_added_cb (GstElement * bin, GstPad * pad, gpointer user_data)
 
   g_object_set (fakesink, "sync", TRUE, "enable-last-sample", FALSE, NULL);
 
-  gst_bin_add (GST_BIN (self->pipeline), fakesink);
+  gst_bin_add (pipeline, fakesink);
 
   if (gst_pad_link (pad, sinkpad) != GST_PAD_LINK_OK)
     GST_ERROR_OBJECT (self, "Could not link pad");
@@ -648,8 +1418,11 @@ pad_removed_cb (GstElement * bin, GstPad * pad, gpointer user_data)
   sink = g_hash_table_lookup (self->fakesinks, pad);
   g_return_if_fail (sink != NULL);
 
+  /* Pads come and go with every track, so don't let these pile up */
+  g_hash_table_remove (self->fakesinks, pad);
+
   gst_element_set_state (sink, GST_STATE_NULL);
-  gst_bin_remove (GST_BIN (self->pipeline), sink);
+  gst_bin_remove (GST_BIN (GST_ELEMENT_PARENT (bin)), sink);
 }
 
 static gboolean
@@ -700,20 +1473,8 @@ bus_cb (GstBus * bus, GstMessage * message, gpointer user_data)
     }
 
     case GST_MESSAGE_EOS: {
-      /* Should we be connecting to about-to-finish instead (and thus forcing
-       * clients to give us a playbin) */
-      if (GST_MESSAGE_SRC (message) == GST_OBJECT (self->pipeline)) {
-        gst_element_set_state (self->pipeline, GST_STATE_NULL);
-        g_signal_emit_by_name (self, "end-of-stream");
-
-        if (self->current_track + 1 == self->n_tracks) {
-          self->current_track = -1;
-          g_signal_emit_by_name (self, "end-of-playlist");
-        } else {
-          /* Go to the next track */
-          update_pipeline (self, TRUE);
-        }
-      }
+      if (GST_MESSAGE_SRC (message) == GST_OBJECT (self->pipeline))
+        end_of_track (self);
 
       break;
     }
@@ -742,6 +1503,133 @@ autoplug_continue_cb (GstElement * uridecodebin, GstPad * pad, GstCaps * caps,
   return TRUE;
 }
 
+static GstElement *
+make_pipeline (GstSyncServer * self, const gchar * name)
+{
+  GstElement *pipeline, *uridecodebin;
+  GstBus *bus;
+
+  uridecodebin = gst_element_factory_make ("uridecodebin", "uridecodebin");
+  if (!uridecodebin)
+    return NULL;
+
+  g_signal_connect (uridecodebin, "pad-added", G_CALLBACK (pad_added_cb),
+      self);
+  g_signal_connect (uridecodebin, "pad-removed", G_CALLBACK (pad_removed_cb),
+      self);
+  g_signal_connect (uridecodebin, "autoplug-continue",
+      G_CALLBACK (autoplug_continue_cb), NULL);
+
+  pipeline = gst_pipeline_new (name);
+  gst_bin_add (GST_BIN (pipeline), uridecodebin);
+
+  gst_element_set_start_time (pipeline, GST_CLOCK_TIME_NONE);
+  gst_pipeline_use_clock (GST_PIPELINE (pipeline), self->clock);
+  gst_pipeline_set_auto_flush_bus (GST_PIPELINE (pipeline), FALSE);
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  gst_bus_add_watch (bus, bus_cb, self);
+  gst_object_unref (bus);
+
+  return pipeline;
+}
+
+static gboolean
+setup_clock (GstSyncServer * self, GError ** error)
+{
+  if (self->clock) {
+    gst_object_unref (self->clock);
+    self->clock = NULL;
+  }
+
+  switch (self->clock_type) {
+    case GST_SYNC_SERVER_CLOCK_TYPE_NET:
+      self->clock = gst_system_clock_obtain ();
+
+      if (self->time_server_threads > 0) {
+        self->time_server = gst_sync_time_server_new (self->clock,
+            self->control_addr, 0, self->time_server_threads);
+
+        if (!gst_sync_time_server_start (self->time_server, error)) {
+          GST_ERROR_OBJECT (self, "Could not start time server");
+          g_object_unref (self->time_server);
+          self->time_server = NULL;
+          return FALSE;
+        }
+
+        g_object_get (self->time_server, "port", &self->clock_port, NULL);
+
+        return TRUE;
+      }
+
+      self->clock_provider =
+        gst_net_time_provider_new (self->clock, self->control_addr, 0);
+
+      if (self->clock_provider == NULL) {
+        GST_ERROR_OBJECT (self, "Could not create net time provider");
+        if (error) {
+          *error = g_error_new (GST_SYNC_SERVER_ERROR, 0,
+              "Failed to initialise network time provider");
+        }
+        return FALSE;
+      }
+
+      g_object_get (self->clock_provider, "port", &self->clock_port, NULL);
+
+      /* Clients synchronise to us, nothing to wait for */
+      return TRUE;
+
+    case GST_SYNC_SERVER_CLOCK_TYPE_PTP:
+      if (!gst_ptp_init (GST_PTP_CLOCK_ID_NONE, NULL)) {
+        GST_ERROR_OBJECT (self, "Could not initialise PTP");
+        if (error) {
+          *error = g_error_new (GST_SYNC_SERVER_ERROR, 0,
+              "Failed to initialise PTP support");
+        }
+        return FALSE;
+      }
+
+      self->clock = gst_ptp_clock_new ("sync-server-clock", self->ptp_domain);
+      break;
+
+    case GST_SYNC_SERVER_CLOCK_TYPE_NTP:
+      if (!self->ntp_addr) {
+        GST_ERROR_OBJECT (self, "Need an NTP server for the NTP clock");
+        if (error) {
+          *error = g_error_new (GST_SYNC_SERVER_ERROR, 0,
+              "No NTP server address specified");
+        }
+        return FALSE;
+      }
+
+      self->clock = gst_ntp_clock_new ("sync-server-clock", self->ntp_addr,
+          self->ntp_port, 0);
+      break;
+  }
+
+  if (!self->clock) {
+    GST_ERROR_OBJECT (self, "Could not create clock");
+    if (error) {
+      *error = g_error_new (GST_SYNC_SERVER_ERROR, 0,
+          "Failed to create clock");
+    }
+    return FALSE;
+  }
+
+  /* Base times we send out are meaningless until we agree with everyone else
+   * on what time it is */
+  if (!gst_clock_wait_for_sync (self->clock, CLOCK_SYNC_TIMEOUT)) {
+    GST_ERROR_OBJECT (self, "Could not synchronise clock");
+    if (error) {
+      *error = g_error_new (GST_SYNC_SERVER_ERROR, 0,
+          "Timed out synchronising clock");
+    }
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
 /**
  * gst_sync_server_start:
  * @server: The #GstSyncServer object
@@ -756,11 +1644,6 @@ autoplug_continue_cb (GstElement * uridecodebin, GstPad * pad, GstCaps * caps,
 gboolean
 gst_sync_server_start (GstSyncServer * server, GError ** error)
 {
-  GstElement *uridecodebin;
-  GstBus *bus;
-
-  server->clock = gst_system_clock_obtain ();
-
   if (!server->n_tracks) {
     GST_ERROR_OBJECT (server, "Need a playlist before we can start");
     if (error) {
@@ -789,22 +1672,14 @@ gst_sync_server_start (GstSyncServer * server, GError ** error)
   if (!gst_sync_control_server_start (server->server, error))
     goto fail;
 
-  server->clock_provider =
-    gst_net_time_provider_new (server->clock, server->control_addr, 0);
-
-  if (server->clock_provider == NULL) {
-    GST_ERROR_OBJECT (server, "Could not create net time provider");
-    if (error) {
-      *error = g_error_new (GST_SYNC_SERVER_ERROR, 0,
-          "Failed to initialise network time provider");
-    }
+  if (!setup_clock (server, error))
     goto fail;
-  }
 
-  g_object_get (server->clock_provider, "port", &server->clock_port, NULL);
+  /* We play in one of these, and open the next track in the other */
+  server->pipeline = make_pipeline (server, "sync-server");
+  server->next_pipeline = make_pipeline (server, "sync-server-next");
 
-  uridecodebin = gst_element_factory_make ("uridecodebin", "uridecodebin");
-  if (!uridecodebin) {
+  if (!server->pipeline || !server->next_pipeline) {
     GST_ERROR_OBJECT (server, "Could not create uridecodebin");
     if (error) {
       *error = g_error_new (GST_SYNC_SERVER_ERROR, 0,
@@ -813,24 +1688,6 @@ gst_sync_server_start (GstSyncServer * server, GError ** error)
     goto fail;
   }
 
-  g_signal_connect (uridecodebin, "pad-added", G_CALLBACK (pad_added_cb),
-      server);
-  g_signal_connect (uridecodebin, "pad-removed", G_CALLBACK (pad_removed_cb),
-      server);
-  g_signal_connect (uridecodebin, "autoplug-continue",
-      G_CALLBACK (autoplug_continue_cb), NULL);
-
-  server->pipeline = gst_pipeline_new ("sync-server");
-  gst_bin_add (GST_BIN (server->pipeline), uridecodebin);
-
-  gst_element_set_start_time (server->pipeline, GST_CLOCK_TIME_NONE);
-  gst_pipeline_use_clock (GST_PIPELINE (server->pipeline), server->clock);
-  gst_pipeline_set_auto_flush_bus (GST_PIPELINE (server->pipeline), FALSE);
-
-  bus = gst_pipeline_get_bus (GST_PIPELINE (server->pipeline));
-  gst_bus_add_watch (bus, bus_cb, server);
-  gst_object_unref (bus);
-
   if (!update_pipeline (server, FALSE)) {
     if (error) {
       *error = g_error_new (GST_SYNC_SERVER_ERROR, 0,
@@ -899,6 +1756,17 @@ gst_sync_server_set_paused (GstSyncServer * server, gboolean paused)
         server->base_time + server->base_time_offset);
   }
 
+  if (is_timed_track (server, server->current_track)) {
+    /* The track now ends later, by however long we were paused */
+    if (server->paused)
+      stop_track_timer (server);
+    else if (!server->stopped)
+      start_track_timer (server);
+
+    push_sync_info (server);
+    return;
+  }
+
   ret = gst_element_set_state (server->pipeline,
       server->paused ? GST_STATE_PAUSED : GST_STATE_PLAYING);
 
@@ -921,6 +1789,25 @@ gst_sync_server_stop (GstSyncServer * server)
   gst_sync_server_cleanup (server);
 }
 
+GType
+gst_sync_server_clock_type_get_type (void)
+{
+  static gsize id = 0;
+  static const GEnumValue values[] = {
+    { GST_SYNC_SERVER_CLOCK_TYPE_NET, "GStreamer network clock", "net" },
+    { GST_SYNC_SERVER_CLOCK_TYPE_PTP, "PTP clock", "ptp" },
+    { GST_SYNC_SERVER_CLOCK_TYPE_NTP, "NTP clock", "ntp" },
+    { 0, NULL, NULL }
+  };
+
+  if (g_once_init_enter (&id)) {
+    GType tmp = g_enum_register_static ("GstSyncServerClockType", values);
+    g_once_init_leave (&id, tmp);
+  }
+
+  return (GType) id;
+}
+
 /**
  * gst_sync_server_playlist_get_tracks:
  * @playlist: The playlist
@@ -62,6 +62,28 @@ GVariant * gst_sync_server_playlist_set_current_track (GVariant * playlist,
 #define GST_TYPE_SYNC_SERVER_TRANSFORM \
   (G_VARIANT_TYPE (GST_SYNC_SERVER_TRANSFORM_FORMAT_STRING))
 
+
+/**
+ * GstSyncServerClockType:
+ * @GST_SYNC_SERVER_CLOCK_TYPE_NET: The server provides a #GstNetTimeProvider,
+ *   and clients use a #GstNetClientClock
+ * @GST_SYNC_SERVER_CLOCK_TYPE_PTP: The server and clients use a #GstPtpClock
+ *   on an existing PTP network
+ * @GST_SYNC_SERVER_CLOCK_TYPE_NTP: The server and clients use a #GstNtpClock
+ *   synchronised to an existing NTP server
+ *
+ * The clock that the server and clients synchronise playback against.
+ */
+typedef enum {
+  GST_SYNC_SERVER_CLOCK_TYPE_NET,
+  GST_SYNC_SERVER_CLOCK_TYPE_PTP,
+  GST_SYNC_SERVER_CLOCK_TYPE_NTP,
+} GstSyncServerClockType;
+
+#define GST_TYPE_SYNC_SERVER_CLOCK_TYPE \
+  (gst_sync_server_clock_type_get_type ())
+GType gst_sync_server_clock_type_get_type (void);
+
 G_END_DECLS
 
 #endif /* __GST_SYNC_SERVER_H */
@@ -0,0 +1,641 @@
+/*
+ * Copyright (C) 2016 Samsung Electronics
+ *   Author: Arun Raghavan <arun@osg.samsung.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * A replacement for GstNetTimeProvider that can keep up with a large number of
+ * clients. It speaks the same protocol, so clients just use a regular
+ * GstNetClientClock.
+ *
+ * Requests are received and answered in batches where recvmmsg()/sendmmsg()
+ * are available, and the work can be spread over several threads. Where
+ * SO_REUSEPORT is available, each thread gets its own socket bound to the same
+ * port so the kernel can distribute clients between them; otherwise the
+ * threads share a single socket.
+ *
+ * Where possible, we ask the kernel to timestamp requests as they arrive
+ * (SO_TIMESTAMPNS). The protocol only has room for one server timestamp, which
+ * clients assume was taken halfway through the round trip, so we answer with
+ * our clock's time halfway between the request arriving and the reply going
+ * out. This way, the time a request spends waiting for us (scheduling latency,
+ * queueing in a batch) cancels out instead of skewing the client's offset
+ * estimate.
+ */
+
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gst/gst.h>
+
+#include "sync-time-server.h"
+
+/* Same as GST_NET_TIME_PACKET_SIZE: the client's local time, followed by our
+ * time, both as big-endian 64-bit integers */
+#define PACKET_SIZE 16
+
+/* Big enough to tell when we got something that isn't a time packet */
+#define MAX_PACKET_SIZE 32
+
+/* How many requests we handle per system call */
+#define BATCH_SIZE 64
+
+/* Kernel timestamps older than this are probably bogus */
+#define MAX_TIMESTAMP_AGE GST_SECOND
+
+#define DEFAULT_PORT 0
+#define DEFAULT_THREADS 1
+#define DEFAULT_KERNEL_TIMESTAMPS TRUE
+
+#if defined(HAVE_RECVMMSG) && defined(SO_TIMESTAMPNS)
+#define HAVE_KERNEL_TIMESTAMPS 1
+#endif
+
+typedef struct {
+  GstSyncTimeServer *server;
+  GSocket *socket;
+  GThread *thread;
+
+#ifdef HAVE_RECVMMSG
+  guint8 bufs[BATCH_SIZE][MAX_PACKET_SIZE];
+  struct sockaddr_storage addrs[BATCH_SIZE];
+  struct iovec iovs[BATCH_SIZE];
+  struct mmsghdr msgs[BATCH_SIZE];
+#ifdef HAVE_KERNEL_TIMESTAMPS
+  guint8 cmsgs[BATCH_SIZE][CMSG_SPACE (sizeof (struct timespec))];
+  gboolean kernel_timestamps;
+#endif
+  struct iovec reply_iovs[BATCH_SIZE];
+  struct mmsghdr replies[BATCH_SIZE];
+#else
+  guint8 buf[MAX_PACKET_SIZE];
+#endif
+} Worker;
+
+struct _GstSyncTimeServer {
+  GObject parent;
+
+  GstClock *clock;
+  gchar *addr;
+  gint port;
+  guint n_threads;
+  gboolean kernel_timestamps;
+
+  GCancellable *cancellable;
+  Worker *workers;
+};
+
+struct _GstSyncTimeServerClass {
+  GObjectClass parent;
+};
+
+#define gst_sync_time_server_parent_class parent_class
+G_DEFINE_TYPE (GstSyncTimeServer, gst_sync_time_server, G_TYPE_OBJECT);
+
+GST_DEBUG_CATEGORY_STATIC (sync_time_server_debug);
+#define GST_CAT_DEFAULT sync_time_server_debug
+
+enum {
+  PROP_0,
+  PROP_CLOCK,
+  PROP_ADDRESS,
+  PROP_PORT,
+  PROP_THREADS,
+  PROP_KERNEL_TIMESTAMPS,
+};
+
+#ifdef HAVE_RECVMMSG
+static void
+worker_init_buffers (Worker * worker)
+{
+  gint i;
+
+  memset (worker->msgs, 0, sizeof (worker->msgs));
+  memset (worker->replies, 0, sizeof (worker->replies));
+
+  for (i = 0; i < BATCH_SIZE; i++) {
+    worker->iovs[i].iov_base = worker->bufs[i];
+    worker->iovs[i].iov_len = MAX_PACKET_SIZE;
+
+    worker->msgs[i].msg_hdr.msg_iov = &worker->iovs[i];
+    worker->msgs[i].msg_hdr.msg_iovlen = 1;
+    worker->msgs[i].msg_hdr.msg_name = &worker->addrs[i];
+
+    /* Replies go back out of the same buffer */
+    worker->reply_iovs[i].iov_base = worker->bufs[i];
+    worker->reply_iovs[i].iov_len = PACKET_SIZE;
+  }
+}
+
+#ifdef HAVE_KERNEL_TIMESTAMPS
+static GstClockTime
+timespec_to_time (const struct timespec * ts)
+{
+  return ts->tv_sec * GST_SECOND + ts->tv_nsec;
+}
+
+/* Returns the realtime clock timestamp the kernel attached to the message, or
+ * GST_CLOCK_TIME_NONE if there isn't one */
+static GstClockTime
+get_kernel_timestamp (struct msghdr * msg)
+{
+  struct cmsghdr *cmsg;
+  struct timespec ts;
+
+  for (cmsg = CMSG_FIRSTHDR (msg); cmsg; cmsg = CMSG_NXTHDR (msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET &&
+        cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+      memcpy (&ts, CMSG_DATA (cmsg), sizeof (ts));
+      return timespec_to_time (&ts);
+    }
+  }
+
+  return GST_CLOCK_TIME_NONE;
+}
+#endif
+
+/* Returns the number of requests that were read */
+static gint
+handle_requests (GstSyncTimeServer * self, Worker * worker)
+{
+  gint fd, n, i, n_replies = 0, sent = 0;
+#ifdef HAVE_KERNEL_TIMESTAMPS
+  GstClockTime real_now = GST_CLOCK_TIME_NONE, clock_now = 0;
+#endif
+
+  fd = g_socket_get_fd (worker->socket);
+
+  for (i = 0; i < BATCH_SIZE; i++) {
+    worker->msgs[i].msg_hdr.msg_namelen = sizeof (worker->addrs[i]);
+#ifdef HAVE_KERNEL_TIMESTAMPS
+    if (worker->kernel_timestamps) {
+      worker->msgs[i].msg_hdr.msg_control = worker->cmsgs[i];
+      worker->msgs[i].msg_hdr.msg_controllen = sizeof (worker->cmsgs[i]);
+    }
+#endif
+  }
+
+  n = recvmmsg (fd, worker->msgs, BATCH_SIZE, MSG_DONTWAIT, NULL);
+  if (n < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      GST_WARNING_OBJECT (self, "Failed to receive: %s", g_strerror (errno));
+    return 0;
+  }
+
+  for (i = 0; i < n; i++) {
+    struct mmsghdr *reply;
+    GstClockTime remote_time = GST_CLOCK_TIME_NONE;
+
+    if (worker->msgs[i].msg_len != PACKET_SIZE)
+      continue;
+
+#ifdef HAVE_KERNEL_TIMESTAMPS
+    if (worker->kernel_timestamps) {
+      GstClockTime received;
+
+      received = get_kernel_timestamp (&worker->msgs[i].msg_hdr);
+
+      if (GST_CLOCK_TIME_IS_VALID (received)) {
+        if (!GST_CLOCK_TIME_IS_VALID (real_now)) {
+          /* Map the kernel's realtime timestamps onto our clock once per
+           * batch */
+          struct timespec ts;
+
+          clock_gettime (CLOCK_REALTIME, &ts);
+          clock_now = gst_clock_get_time (self->clock);
+          real_now = timespec_to_time (&ts);
+        }
+
+        if (received <= real_now && real_now - received < MAX_TIMESTAMP_AGE &&
+            real_now - received <= clock_now)
+          remote_time = clock_now - (real_now - received) / 2;
+      }
+    }
+#endif
+
+    /* Otherwise, sample the clock as late as possible for each request, so
+     * that queueing inside the batch doesn't show up as clock error */
+    if (!GST_CLOCK_TIME_IS_VALID (remote_time))
+      remote_time = gst_clock_get_time (self->clock);
+
+    GST_WRITE_UINT64_BE (worker->bufs[i] + 8, remote_time);
+
+    reply = &worker->replies[n_replies++];
+    reply->msg_hdr.msg_name = &worker->addrs[i];
+    reply->msg_hdr.msg_namelen = worker->msgs[i].msg_hdr.msg_namelen;
+    reply->msg_hdr.msg_iov = &worker->reply_iovs[i];
+    reply->msg_hdr.msg_iovlen = 1;
+  }
+
+  while (sent < n_replies) {
+    gint ret;
+
+    ret = sendmmsg (fd, worker->replies + sent, n_replies - sent, 0);
+    if (ret < 0) {
+      if (errno == EINTR)
+        continue;
+
+      /* The socket buffer is full, the clients will just retry */
+      GST_DEBUG_OBJECT (self, "Dropping %d replies: %s", n_replies - sent,
+          g_strerror (errno));
+      break;
+    }
+
+    sent += ret;
+  }
+
+  return n;
+}
+#else
+static void
+worker_init_buffers (Worker * worker)
+{
+}
+
+/* Returns the number of requests that were read */
+static gint
+handle_requests (GstSyncTimeServer * self, Worker * worker)
+{
+  GSocketAddress *from = NULL;
+  gssize len;
+
+  len = g_socket_receive_from (worker->socket, &from, (gchar *) worker->buf,
+      MAX_PACKET_SIZE, NULL, NULL);
+  if (len < 0)
+    return 0;
+
+  if (len == PACKET_SIZE) {
+    GST_WRITE_UINT64_BE (worker->buf + 8, gst_clock_get_time (self->clock));
+    g_socket_send_to (worker->socket, from, (gchar *) worker->buf,
+        PACKET_SIZE, NULL, NULL);
+  }
+
+  g_object_unref (from);
+
+  return 1;
+}
+#endif
+
+static gpointer
+worker_thread (gpointer user_data)
+{
+  Worker *worker = user_data;
+  GstSyncTimeServer *self = worker->server;
+  GError *err = NULL;
+
+  while (g_socket_condition_wait (worker->socket, G_IO_IN, self->cancellable,
+        &err)) {
+    /* Drain everything that's queued before going back to sleep */
+    while (handle_requests (self, worker) > 0)
+      ;
+  }
+
+  if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    GST_ERROR_OBJECT (self, "Time server thread failed: %s", err->message);
+
+  g_error_free (err);
+
+  return NULL;
+}
+
+static void
+gst_sync_time_server_dispose (GObject * object)
+{
+  GstSyncTimeServer *self = GST_SYNC_TIME_SERVER (object);
+
+  gst_sync_time_server_stop (self);
+
+  if (self->clock) {
+    gst_object_unref (self->clock);
+    self->clock = NULL;
+  }
+
+  g_free (self->addr);
+  self->addr = NULL;
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
+}
+
+static void
+gst_sync_time_server_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstSyncTimeServer *self = GST_SYNC_TIME_SERVER (object);
+
+  switch (property_id) {
+    case PROP_CLOCK:
+      if (self->clock)
+        gst_object_unref (self->clock);
+
+      self->clock = g_value_dup_object (value);
+      break;
+
+    case PROP_ADDRESS:
+      g_free (self->addr);
+      self->addr = g_value_dup_string (value);
+      break;
+
+    case PROP_PORT:
+      self->port = g_value_get_int (value);
+      break;
+
+    case PROP_THREADS:
+      self->n_threads = g_value_get_uint (value);
+      break;
+
+    case PROP_KERNEL_TIMESTAMPS:
+      self->kernel_timestamps = g_value_get_boolean (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_sync_time_server_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstSyncTimeServer *self = GST_SYNC_TIME_SERVER (object);
+
+  switch (property_id) {
+    case PROP_CLOCK:
+      g_value_set_object (value, self->clock);
+      break;
+
+    case PROP_ADDRESS:
+      g_value_set_string (value, self->addr);
+      break;
+
+    case PROP_PORT:
+      g_value_set_int (value, self->port);
+      break;
+
+    case PROP_THREADS:
+      g_value_set_uint (value, self->n_threads);
+      break;
+
+    case PROP_KERNEL_TIMESTAMPS:
+      g_value_set_boolean (value, self->kernel_timestamps);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_sync_time_server_class_init (GstSyncTimeServerClass * klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = gst_sync_time_server_dispose;
+  object_class->set_property = gst_sync_time_server_set_property;
+  object_class->get_property = gst_sync_time_server_get_property;
+
+  g_object_class_install_property (object_class, PROP_CLOCK,
+      g_param_spec_object ("clock", "Clock", "The clock to serve",
+        GST_TYPE_CLOCK, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_ADDRESS,
+      g_param_spec_string ("address", "Address", "Address to listen on", NULL,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_PORT,
+      g_param_spec_int ("port", "Port",
+        "Port to listen on (0 = pick one, updated once started)", 0, 65535,
+        DEFAULT_PORT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads",
+        "Number of threads answering requests", 1, G_MAXUINT,
+        DEFAULT_THREADS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class, PROP_KERNEL_TIMESTAMPS,
+      g_param_spec_boolean ("kernel-timestamps", "Kernel timestamps",
+        "Use kernel receive timestamps where available",
+        DEFAULT_KERNEL_TIMESTAMPS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  GST_DEBUG_CATEGORY_INIT (sync_time_server_debug, "synctimeserver", 0,
+      "GstSyncTimeServer");
+}
+
+static void
+gst_sync_time_server_init (GstSyncTimeServer * self)
+{
+  self->clock = NULL;
+  self->addr = NULL;
+  self->port = DEFAULT_PORT;
+  self->n_threads = DEFAULT_THREADS;
+  self->kernel_timestamps = DEFAULT_KERNEL_TIMESTAMPS;
+
+  self->cancellable = NULL;
+  self->workers = NULL;
+}
+
+/*
+ * gst_sync_time_server_new:
+ * @clock: The clock to provide
+ * @address: The address to listen on
+ * @port: The port to listen on, or 0 to pick one
+ * @n_threads: How many threads to answer requests with
+ *
+ * Returns: (transfer full): A new #GstSyncTimeServer, which needs to be
+ *          started with gst_sync_time_server_start().
+ */
+GstSyncTimeServer *
+gst_sync_time_server_new (GstClock * clock, const gchar * address, gint port,
+    guint n_threads)
+{
+  return
+    g_object_new (GST_TYPE_SYNC_TIME_SERVER,
+        "clock", clock,
+        "address", address,
+        "port", port,
+        "threads", n_threads,
+        NULL);
+}
+
+static GSocket *
+make_socket (GstSyncTimeServer * self, GSocketAddress * sockaddr,
+    GError ** err)
+{
+  GSocket *socket;
+
+  socket = g_socket_new (g_socket_address_get_family (sockaddr),
+      G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, err);
+  if (!socket)
+    return NULL;
+
+  g_socket_set_blocking (socket, FALSE);
+
+#ifdef SO_REUSEPORT
+  if (self->n_threads > 1 &&
+      !g_socket_set_option (socket, SOL_SOCKET, SO_REUSEPORT, 1, err)) {
+    g_object_unref (socket);
+    return NULL;
+  }
+#endif
+
+  /* We don't want anyone else grabbing our port, so no SO_REUSEADDR */
+  if (!g_socket_bind (socket, sockaddr, FALSE, err)) {
+    g_object_unref (socket);
+    return NULL;
+  }
+
+  return socket;
+}
+
+/*
+ * gst_sync_time_server_start:
+ * @server: The #GstSyncTimeServer
+ * @error: If non-NULL, will be set to the appropriate #GError if starting the
+ *         server fails
+ *
+ * Binds the configured address/port and starts answering requests. The port
+ * that was actually bound is available in the "port" property afterwards.
+ *
+ * Returns: #TRUE on success, and #FALSE if the server could not be started.
+ */
+gboolean
+gst_sync_time_server_start (GstSyncTimeServer * server, GError ** error)
+{
+  GstSyncTimeServer *self = server;
+  GSocketAddress *sockaddr, *local;
+  guint i;
+
+  g_return_val_if_fail (self->clock != NULL, FALSE);
+  g_return_val_if_fail (self->workers == NULL, FALSE);
+
+  sockaddr = g_inet_socket_address_new_from_string (self->addr, self->port);
+  if (!sockaddr) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+        "Invalid time server address: %s", self->addr);
+    return FALSE;
+  }
+
+  self->cancellable = g_cancellable_new ();
+  self->workers = g_new0 (Worker, self->n_threads);
+
+  for (i = 0; i < self->n_threads; i++) {
+    Worker *worker = &self->workers[i];
+
+    worker->server = self;
+
+#ifdef SO_REUSEPORT
+    worker->socket = make_socket (self, sockaddr, error);
+#else
+    worker->socket = i == 0 ? make_socket (self, sockaddr, error) :
+      g_object_ref (self->workers[0].socket);
+#endif
+
+    if (!worker->socket)
+      goto fail;
+
+    if (i == 0 && self->port == 0) {
+      /* The rest of the sockets need to bind to the port we got */
+      local = g_socket_get_local_address (worker->socket, error);
+      if (!local)
+        goto fail;
+
+      self->port =
+        g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (local));
+
+      g_object_unref (sockaddr);
+      sockaddr = local;
+    }
+
+    worker_init_buffers (worker);
+
+#ifdef HAVE_KERNEL_TIMESTAMPS
+    /* Not fatal, we just fall back to reading the clock ourselves */
+    worker->kernel_timestamps = self->kernel_timestamps &&
+      g_socket_set_option (worker->socket, SOL_SOCKET, SO_TIMESTAMPNS, 1,
+          NULL);
+
+    if (self->kernel_timestamps && !worker->kernel_timestamps)
+      GST_WARNING_OBJECT (self, "Could not enable kernel timestamps");
+#endif
+  }
+
+  for (i = 0; i < self->n_threads; i++) {
+    self->workers[i].thread =
+      g_thread_new ("sync-time", worker_thread, &self->workers[i]);
+  }
+
+  GST_INFO_OBJECT (self, "Serving time on port %d with %u thread(s)",
+      self->port, self->n_threads);
+
+  g_object_unref (sockaddr);
+
+  return TRUE;
+
+fail:
+  g_object_unref (sockaddr);
+  gst_sync_time_server_stop (self);
+
+  return FALSE;
+}
+
+/*
+ * gst_sync_time_server_stop:
+ * @server: The #GstSyncTimeServer
+ *
+ * Stops answering requests and closes all sockets.
+ */
+void
+gst_sync_time_server_stop (GstSyncTimeServer * server)
+{
+  GstSyncTimeServer *self = server;
+  guint i;
+
+  if (!self->workers)
+    return;
+
+  g_cancellable_cancel (self->cancellable);
+
+  for (i = 0; i < self->n_threads; i++) {
+    Worker *worker = &self->workers[i];
+
+    if (worker->thread)
+      g_thread_join (worker->thread);
+
+    if (worker->socket) {
+      g_socket_close (worker->socket, NULL);
+      g_object_unref (worker->socket);
+    }
+  }
+
+  g_free (self->workers);
+  self->workers = NULL;
+
+  g_object_unref (self->cancellable);
+  self->cancellable = NULL;
+}